@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Licznik alokacji na stercie do sprawdzania, że takt gry w stanie ustalonym
+// nie alokuje. Przy kompilacji z -DCOUNT_ALLOCS=1 (make COUNT_ALLOCS=1) plik
+// zastępuje globalne operator new/delete wersjami, które liczą wywołania
+// osobno w każdym wątku - może go więc dołączać tylko jeden plik programu.
+// Bez tej flagi licznik zawsze wynosi 0 i nie ma żadnego narzutu.
+// Liczone są tylko alokacje przez new (także kontenery biblioteki
+// standardowej), nie bezpośrednie malloc.
+
+#ifndef COUNT_ALLOCS
+#define COUNT_ALLOCS 0
+#endif
+
+inline thread_local uint64_t thread_heap_allocations = 0;
+
+// Alokacje wykonane dotąd przez bieżący wątek
+inline uint64_t heap_allocations() { return thread_heap_allocations; }
+
+#if COUNT_ALLOCS
+// noinline: po wstawieniu malloc()/free() w miejscach new i delete kompilator
+// widzi parę new/free i zgłasza fałszywe -Wmismatched-new-delete
+__attribute__((noinline)) void* operator new(size_t size) {
+    thread_heap_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) { return operator new(size); }
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept { std::free(p); }
+#endif
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "common.h"
+#include "physics_batch.h"
+#include "snapshot.h"
+#include "spsc_ring.h"
+#include "wire.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <cstdio>
+
+// Mikrobenchmarki symulacji, kolizji, kodowania migawek i komunikatów oraz kolejki akcji.
+//
+// Każdy benchmark jest kalibrowany (liczba iteracji na ~BENCH_TARGET_MS),
+// a potem powtarzany BENCH_REPEATS razy; raportowana jest mediana i minimum
+// czasu na operację. Wynik to TSV (nazwa, ns/op mediana, ns/op min, op/s,
+// iteracje) - stabilne nazwy i kolejność pozwalają porównywać wyniki
+// z różnych commitów zwykłym diff/join.
+//
+// Użycie: ./the4pong_bench [fragment nazwy]
+
+using Clock = std::chrono::steady_clock;
+
+const int BENCH_TARGET_MS = 100;
+const int BENCH_REPEATS = 5;
+const int BENCH_ROOMS = 256;  // MAX_ROOMS serwera
+const float BENCH_DT = 1.0f / DEFAULT_TICK_RATE;
+// Długi krok: kulka przelatuje kilka razy przez arenę, więc każdy krok to seria odbić
+const float BENCH_BOUNCE_DT = 10.0f;
+// Krok, przy którym większość pokoi wychodzi poza strefę bez kolizji (ścieżka skalarna)
+const float BENCH_COLLIDE_DT = 0.5f;
+
+// Bariera dla optymalizatora - wynik uznawany za użyty.
+// Struktury i tablice przez adres: "r,m"(value) kopiuje je szerokimi odczytami,
+// co przy zapisie pole po polu mierzy zablokowane przekazanie zapisu, nie kod.
+template <typename T>
+inline void keep(const T& value) {
+    if constexpr (sizeof(T) <= sizeof(uint64_t) && std::is_trivially_copyable<T>::value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    } else {
+        asm volatile("" : : "r"(&value) : "memory");
+    }
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double ns_median;
+    double ns_min;
+};
+
+// body(n) wykonuje n operacji
+using BenchBody = std::function<void(uint64_t)>;
+
+static double time_ns(const BenchBody& body, uint64_t iterations) {
+    auto start = Clock::now();
+    body(iterations);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static BenchResult run_bench(const std::string& name, const BenchBody& body) {
+    // Kalibracja: podwajaj liczbę iteracji, aż pomiar trwa co najmniej 10 ms
+    uint64_t iterations = 1;
+    double elapsed = time_ns(body, iterations);
+    while (elapsed < 10e6 && iterations < (1ull << 40)) {
+        iterations *= 2;
+        elapsed = time_ns(body, iterations);
+    }
+    iterations = std::max<uint64_t>(1, (uint64_t)(iterations * (BENCH_TARGET_MS * 1e6 / elapsed)));
+    
+    std::vector<double> samples;
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+        samples.push_back(time_ns(body, iterations) / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+    return BenchResult{name, iterations, samples[samples.size() / 2], samples.front()};
+}
+
+// Gra w toku: platformy na środku ścian, kulka leci pionowo między nimi
+static GameState running_state() {
+    GameState state;
+    state.game_running = true;
+    state.active_players = 4;
+    state.ball.velocity_x = 0;
+    state.ball.velocity_y = BALL_SPEED;
+    return state;
+}
+
+// Świat z losowymi kulkami we wszystkich pokojach (ziarno stałe - powtarzalne wyniki)
+static void fill_world(BatchWorld& world, int rooms) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(SAFE_MIN + 5, SAFE_MAX - 5);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    
+    for (int slot = 0; slot < rooms; slot++) {
+        GameState state = running_state();
+        state.ball.x = position(rng);
+        state.ball.y = position(rng);
+        float a = angle(rng);
+        state.ball.velocity_x = BALL_SPEED * std::cos(a);
+        state.ball.velocity_y = BALL_SPEED * std::sin(a);
+        for (int p = 0; p < 4; p++) {
+            state.paddles[p].set_action((PlayerAction)((slot + p) % 3));
+        }
+        world.load(slot, state);
+    }
+}
+
+// Pokoje, w których gra się skończyła, zaczynają od nowa (poza pomiarem byłoby
+// drożej niż sam restart - to tylko kopia kilku liczb)
+static void restart_finished(BatchWorld& world, int rooms, const GameState& fresh) {
+    for (int slot = 0; slot < rooms; slot++) {
+        if (!world.is_running(slot)) world.load(slot, fresh);
+    }
+}
+
+static std::vector<BenchResult> run_all(const std::string& filter) {
+    std::vector<BenchResult> results;
+    auto add = [&](const std::string& name, const BenchBody& body) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) return;
+        results.push_back(run_bench(name, body));
+        const BenchResult& r = results.back();
+        printf("%s\t%.2f\t%.2f\t%.0f\t%llu\n", r.name.c_str(), r.ns_median, r.ns_min,
+               1e9 / r.ns_median, (unsigned long long)r.iterations);
+        fflush(stdout);
+    };
+    
+    // --- GameState: jeden pokój ---
+    
+    add("gamestate_update", [](uint64_t n) {
+        GameState state = running_state();
+        for (uint64_t i = 0; i < n; i++) {
+            if ((i & 63) == 0) state.paddles[1].set_action((PlayerAction)((i >> 6) % 3));
+            state.update(BENCH_DT);
+            if (!state.game_running) state = running_state();
+        }
+        keep(state.ball.x);
+    });
+    
+    // Seria odbić w każdym kroku: ciągła detekcja kolizji + normalizacja prędkości (sqrt)
+    add("gamestate_update_bounces", [](uint64_t n) {
+        GameState state = running_state();
+        for (uint64_t i = 0; i < n; i++) {
+            state.update(BENCH_BOUNCE_DT);
+            if (!state.game_running) state = running_state();
+        }
+        keep(state.ball.x);
+    });
+    
+    // Kąt odbicia zależny od miejsca uderzenia - kulka w końcu mija platformę,
+    // więc mierzone są też trafienia w ścianę, reset kulki i koniec gry
+    add("gamestate_update_angled", [](uint64_t n) {
+        GameState fresh = running_state();
+        fresh.ball.x += 2.0f;
+        GameState state = fresh;
+        for (uint64_t i = 0; i < n; i++) {
+            state.update(BENCH_BOUNCE_DT);
+            if (!state.game_running) state = fresh;
+        }
+        keep(state.ball.x);
+    });
+    
+    // --- BatchWorld: wiele pokoi jednym przebiegiem, każdy kernel osobno ---
+    
+    struct KernelInfo {
+        BatchWorld::Kernel kernel;
+        const char* name;
+    };
+    const KernelInfo kernels[] = {
+        {BatchWorld::KERNEL_SCALAR, "scalar"},
+        {BatchWorld::KERNEL_SSE, "sse"},
+        {BatchWorld::KERNEL_AVX2, "avx2"},
+    };
+    
+    for (const KernelInfo& info : kernels) {
+        if (info.kernel > BatchWorld::best_kernel()) continue;
+        
+        for (int rooms : {1, BENCH_ROOMS}) {
+            std::string name = "batch_step_" + std::string(info.name) + "_" + std::to_string(rooms);
+            add(name, [info, rooms](uint64_t n) {
+                BatchWorld world(rooms);
+                world.set_kernel(info.kernel);
+                fill_world(world, rooms);
+                GameState fresh = running_state();
+                for (uint64_t i = 0; i < n; i++) {
+                    world.step(BENCH_DT);
+                    if ((i & 255) == 255) restart_finished(world, rooms, fresh);
+                }
+                keep(world.ball_x[0]);
+            });
+        }
+        
+        std::string name = "batch_step_collide_" + std::string(info.name) + "_" + std::to_string(BENCH_ROOMS);
+        add(name, [info](uint64_t n) {
+            BatchWorld world(BENCH_ROOMS);
+            world.set_kernel(info.kernel);
+            fill_world(world, BENCH_ROOMS);
+            GameState fresh = running_state();
+            for (uint64_t i = 0; i < n; i++) {
+                world.step(BENCH_COLLIDE_DT);
+                restart_finished(world, BENCH_ROOMS, fresh);
+            }
+            keep(world.ball_x[0]);
+        });
+    }
+    
+    // --- Migawki ---
+    
+    Snapshot base{};
+    base.seq = 100;
+    base.tick = 200;
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) base.fields[i] = quantize(10.0f + i);
+    for (int i = 0; i < 4; i++) base.scores[i] = INITIAL_SCORE;
+    
+    // Typowa różnica: zmieniona tylko pozycja kulki
+    Snapshot next = base;
+    next.seq = 101;
+    next.tick = 202;
+    next.fields[FIELD_BALL_X] += 128;
+    next.fields[FIELD_BALL_Y] -= 64;
+    
+    SnapshotInput input{42, 1};
+    
+    add("snapshot_encode_full", [=](uint64_t n) {
+        uint8_t buffer[SNAPSHOT_MAX_SIZE];
+        Snapshot snapshot = next;
+        for (uint64_t i = 0; i < n; i++) {
+            snapshot.fields[FIELD_BALL_X] = (int16_t)i;
+            keep(encode_snapshot(snapshot, nullptr, input, buffer));
+        }
+        keep(buffer[0]);
+    });
+    
+    add("snapshot_encode_delta", [=](uint64_t n) {
+        uint8_t buffer[SNAPSHOT_MAX_SIZE];
+        Snapshot snapshot = next;
+        for (uint64_t i = 0; i < n; i++) {
+            snapshot.fields[FIELD_BALL_X] = (int16_t)i;
+            keep(encode_snapshot(snapshot, &base, input, buffer));
+        }
+        keep(buffer[0]);
+    });
+    
+    add("snapshot_decode_full", [=](uint64_t n) {
+        SnapshotHistory history;
+        uint8_t buffer[SNAPSHOT_MAX_SIZE];
+        size_t length = encode_snapshot(next, nullptr, input, buffer);
+        Snapshot snapshot;
+        SnapshotInput decoded;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(decode_snapshot(buffer, length, history, snapshot, decoded));
+        }
+        keep(snapshot.fields[0]);
+    });
+    
+    add("snapshot_decode_delta", [=](uint64_t n) {
+        SnapshotHistory history;
+        history.put(base);
+        uint8_t buffer[SNAPSHOT_MAX_SIZE];
+        size_t length = encode_snapshot(next, &base, input, buffer);
+        Snapshot snapshot;
+        SnapshotInput decoded;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(decode_snapshot(buffer, length, history, snapshot, decoded));
+        }
+        keep(snapshot.fields[0]);
+    });
+    
+    // --- Komunikaty: schemat z wire.h wobec kopiowania struktury bajt w bajt ---
+    // (raw_* to dawny format: bajt typu i memcpy struktury). keep(packet) przed
+    // kodowaniem wymusza ponowny odczyt pakietu w każdej iteracji - bez zapisu
+    // pojedynczego pola tuż przed kopią całej struktury (zablokowane przekazanie
+    // zapisu) i bez zwijania kodowania stałego pakietu przez kompilator.
+    
+    PlayerActionPacket action_packet{};
+    action_packet.session_token = 0x0123456789ABCDEFull;
+    action_packet.input_seq = 1000;
+    action_packet.count = INPUT_REDUNDANCY;
+    for (int i = 0; i < INPUT_REDUNDANCY; i++) action_packet.actions[i] = i % 3;
+    
+    PlayerJoinedPacket joined_packet{};
+    joined_packet.player_id = 2;
+    joined_packet.nick_length = 9;
+    strcpy(joined_packet.nick, "gracz_abc");
+    joined_packet.tick_rate = DEFAULT_TICK_RATE;
+    joined_packet.session_token = 0xFEDCBA9876543210ull;
+    
+    add("packet_action_raw_copy", [=](uint64_t n) {
+        uint8_t buffer[1 + sizeof(PlayerActionPacket)];
+        PlayerActionPacket packet = action_packet;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(packet);
+            buffer[0] = PACKET_PLAYER_ACTION;
+            memcpy(buffer + 1, &packet, sizeof(packet));
+            keep(buffer);
+        }
+        keep(buffer[1]);
+    });
+    
+    add("packet_action_encode", [=](uint64_t n) {
+        uint8_t buffer[1 + WIRE_MAX_SIZE<PlayerActionPacket>];
+        PlayerActionPacket packet = action_packet;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(packet);
+            keep(wire_encode_datagram(packet, buffer));
+            keep(buffer);
+        }
+        keep(buffer[1]);
+    });
+    
+    add("packet_action_raw_read", [=](uint64_t n) {
+        uint8_t buffer[1 + sizeof(PlayerActionPacket)];
+        buffer[0] = PACKET_PLAYER_ACTION;
+        memcpy(buffer + 1, &action_packet, sizeof(action_packet));
+        PlayerActionPacket packet;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(buffer);
+            if (sizeof(buffer) >= 1 + sizeof(packet)) memcpy(&packet, buffer + 1, sizeof(packet));
+            keep(packet);
+        }
+    });
+    
+    add("packet_action_decode", [=](uint64_t n) {
+        uint8_t buffer[1 + WIRE_MAX_SIZE<PlayerActionPacket>];
+        size_t length = wire_encode_datagram(action_packet, buffer);
+        PlayerActionPacket packet;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(buffer);
+            keep(wire_decode(buffer + 1, length - 1, packet));
+            keep(packet);
+        }
+    });
+    
+    // Z napisem: stała część bitowo, nick bez dopełnienia do 21 bajtów
+    add("packet_joined_raw_copy", [=](uint64_t n) {
+        uint8_t buffer[sizeof(PlayerJoinedPacket)];
+        PlayerJoinedPacket packet = joined_packet;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(packet);
+            memcpy(buffer, &packet, sizeof(packet));
+            keep(buffer);
+        }
+        keep(buffer[0]);
+    });
+    
+    add("packet_joined_encode", [=](uint64_t n) {
+        uint8_t buffer[WIRE_MAX_SIZE<PlayerJoinedPacket>];
+        PlayerJoinedPacket packet = joined_packet;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(packet);
+            keep(wire_encode(packet, buffer));
+            keep(buffer);
+        }
+        keep(buffer[0]);
+    });
+    
+    add("packet_joined_raw_read", [=](uint64_t n) {
+        uint8_t buffer[sizeof(PlayerJoinedPacket)];
+        memcpy(buffer, &joined_packet, sizeof(joined_packet));
+        PlayerJoinedPacket packet;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(buffer);
+            memcpy(&packet, buffer, sizeof(packet));
+            keep(packet);
+        }
+    });
+    
+    add("packet_joined_decode", [=](uint64_t n) {
+        uint8_t buffer[WIRE_MAX_SIZE<PlayerJoinedPacket>];
+        size_t length = wire_encode(joined_packet, buffer);
+        PlayerJoinedPacket packet;
+        for (uint64_t i = 0; i < n; i++) {
+            keep(buffer);
+            keep(wire_decode(buffer, length, packet));
+            keep(packet);
+        }
+    });
+    
+    // --- Kolejka akcji (SpscRing jak w Room::action_queue) ---
+    
+    struct BenchEvent {
+        int player_id;
+        PlayerAction action;
+        uint32_t input_seq;
+        Clock::time_point timestamp;
+    };
+    
+    // Jeden wątek: seria wstawień i zdjęć (koszt samej struktury); op = jedna akcja
+    add("spsc_push_pop", [](uint64_t n) {
+        static SpscRing<BenchEvent, 64> ring;
+        BenchEvent event{0, ACTION_STOP, 0, Clock::time_point()};
+        uint64_t done = 0;
+        while (done < n) {
+            uint64_t batch = std::min<uint64_t>(32, n - done);
+            for (uint64_t i = 0; i < batch; i++) {
+                event.input_seq = (uint32_t)(done + i);
+                ring.push(event);
+            }
+            for (uint64_t i = 0; i < batch; i++) {
+                ring.pop(event);
+            }
+            done += batch;
+        }
+        keep(event.input_seq);
+    });
+    
+    // Producent i konsument w osobnych wątkach (przepływ przez linie cache)
+    add("spsc_cross_thread", [](uint64_t n) {
+        static SpscRing<BenchEvent, 64> ring;
+        std::thread consumer([n]() {
+            BenchEvent event{};
+            uint64_t received = 0;
+            while (received < n) {
+                if (ring.pop(event)) {
+                    received++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            keep(event.input_seq);
+        });
+        
+        BenchEvent event{0, ACTION_STOP, 0, Clock::time_point()};
+        for (uint64_t i = 0; i < n; i++) {
+            event.input_seq = (uint32_t)i;
+            while (!ring.push(event)) std::this_thread::yield();
+        }
+        consumer.join();
+    });
+    
+    return results;
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    
+    static const char* kernel_names[] = {"scalar", "sse", "avx2"};
+    printf("# the4pong bench: kernel=%s, powtórzeń=%d, cel=%d ms\n",
+           kernel_names[BatchWorld::best_kernel()], BENCH_REPEATS, BENCH_TARGET_MS);
+    printf("# nazwa\tns_op_mediana\tns_op_min\top_s\titeracje\n");
+    std::vector<BenchResult> results = run_all(filter);
+    
+    if (results.empty()) {
+        std::cerr << "Brak benchmarków pasujących do: " << filter << "\n";
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
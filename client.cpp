@@ -1,26 +1,43 @@
 #include "common.h"
+#include "snapshot.h"
+#include "interpolation.h"
+#include "logger.h"
+#include "screen.h"
+#include "framing.h"
+#include "wire.h"
 #include <iostream>
-#include <thread>
-#include <mutex>
 #include <chrono>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <cstring>
+#include <cerrno>
+#include <poll.h>
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <ncurses.h>
 
-void logToFile(const std::string& message) {
-    std::ofstream logFile("log_client.txt", std::ios::app); // tryb dopisywania (append)
-    if (logFile.is_open()) {
-        logFile << "[LOG]" << message << std::endl;
-    } else {
-        std::cerr << "Nie można otworzyć pliku log.txt!" << std::endl;
-    }
-}
+// Liczba pamiętanych wejść gracza (do ponownego odtworzenia po synchronizacji)
+const int INPUT_HISTORY = 64;
+// Co ile powtarzać wejścia niepotwierdzone przez serwer (zgubione ostatnie wejście
+// nie ma następcy, który przeniósłby je w redundancji)
+const auto INPUT_RESEND_INTERVAL = std::chrono::milliseconds(50);
+
+// Wejście gracza zastosowane lokalnie przed potwierdzeniem przez serwer
+struct PendingInput {
+    uint32_t seq;
+    PlayerAction action;
+    int64_t tick;  // liczba lokalnych taktów wykonanych przed zastosowaniem wejścia
+};
+
+// Kopia stanu potrzebna do narysowania klatki
+struct RenderView {
+    float ball_x, ball_y;
+    std::array<float, 4> paddles;
+    std::array<int, 4> scores;
+};
 
 class GameClient {
 private:
@@ -29,20 +46,47 @@ private:
     int udp_socket;
     sockaddr_in server_addr;
     int my_player_id;
+    uint64_t session_token;     // z PLAYER_JOINED, dołączany do każdego pakietu UDP
+    int tick_rate;
     bool connected;
+    bool running;               // pętla zdarzeń działa (false po końcu gry lub wyjściu)
     bool game_active;
-    std::mutex state_mutex;
-    std::thread network_thread;
-    std::thread input_thread;
+    bool spectator;             // tryb widza - bez platformy i wejść
+    SnapshotHistory snapshots;  // odebrane migawki - bazy dla różnic od serwera
+    InterpolationBuffer interpolation;  // kulka i cudze platformy rysowane z opóźnieniem
+    bool has_snapshot;
+    uint16_t last_snapshot;     // najnowsza zastosowana migawka
+    std::array<PendingInput, INPUT_HISTORY> inputs;
+    uint32_t next_input_seq;
+    uint32_t acked_input_seq;   // najnowsze wejście potwierdzone w migawce
+    std::chrono::steady_clock::time_point last_input_send;
+    std::array<uint32_t, 4> remote_input_seq;  // ostatnie propagowane wejścia innych graczy
+    int64_t local_tick;         // liczba wykonanych lokalnie taktów symulacji
+    int tick_timer;             // timerfd taktu klienta (uzbrajany przy starcie gry)
+    bool screen_active;         // ncurses zainicjalizowany
+    bool left_pressed, right_pressed;
+    std::string end_summary;    // wyniki z GAME_END, wypisywane po zamknięciu ekranu gry
+    FrameReader tcp_in;         // ramki odebrane z serwera
+    FrameWriter tcp_out;        // komunikaty czekające na wysłanie
+    ScreenBuffer screen;
+    std::array<int, 4> drawn_scores;  // wyniki narysowane w warstwie tła
+    int arena_y, arena_x;             // położenie i rozmiar areny na ekranie
+    int arena_width, arena_height;
     
 public:
-    GameClient() : tcp_socket(-1), udp_socket(-1), my_player_id(-1), 
-                   connected(false), game_active(false) {}
+    GameClient() : tcp_socket(-1), udp_socket(-1), my_player_id(-1), session_token(0), tick_rate(DEFAULT_TICK_RATE),
+                   connected(false), running(false), game_active(false), spectator(false), has_snapshot(false), last_snapshot(0),
+                   inputs{}, next_input_seq(1), acked_input_seq(0), remote_input_seq{}, local_tick(0),
+                   tick_timer(-1), screen_active(false), left_pressed(false), right_pressed(false), drawn_scores{}, arena_y(0), arena_x(0), arena_width(0), arena_height(0) {}
     
     ~GameClient() {
         disconnect();
     }
     
+    void set_interpolation_delay(float seconds) {
+        interpolation.set_delay(seconds);
+    }
+    
       
     bool connect_to_server(const std::string& ip, int port) {
         // Tworzenie socketów
@@ -78,238 +122,554 @@ public:
             return false;
         }
         
+        if (!negotiate_version()) {
+            close(tcp_socket);
+            close(udp_socket);
+            return false;
+        }
+        
         connected = true;
         return true;
     }
     
     
-    bool join_lobby(const std::string& nick) {
+    // Wybiera pokój na serwerze (tworzy go, jeśli nie istnieje).
+    // Pusta nazwa oznacza szybką grę w dowolnym pokoju z wolnym miejscem.
+    bool join_room(const std::string& room_name) {
         if (!connected) return false;
         
-        uint8_t packet_type = PACKET_JOIN_LOBBY;
-        send(tcp_socket, &packet_type, 1, 0);
+        CreateJoinServerPacket create_packet{};
+        create_packet.server_name_length = std::min(room_name.length(), sizeof(create_packet.server_name) - 1);
+        memcpy(create_packet.server_name, room_name.c_str(), create_packet.server_name_length);
+        send_packet(create_packet);
+        
+        ServerResponsePacket response;
+        if (!wait_for_packet(response)) {
+            return false;
+        }
+        return response.port != -1;
+    }
+    
+    bool join_lobby(const std::string& nick) {
+        if (!connected) return false;
         
         JoinLobbyPacket join_packet;
         join_packet.nick_length = nick.length();
         strncpy(join_packet.nick, nick.c_str(), sizeof(join_packet.nick) - 1);
         join_packet.nick[sizeof(join_packet.nick) - 1] = '\0';
-        
-        send(tcp_socket, &join_packet, sizeof(join_packet), 0);
+        send_packet(join_packet);
         
         // Odbierz potwierdzenie
-        uint8_t response_type;
-        recv(tcp_socket, &response_type, 1, 0);
-        
-        if (response_type != PACKET_PLAYER_JOINED) {
+        PlayerJoinedPacket response;
+        if (!wait_for_packet(response)) {
             return false;
         }
-        
-        PlayerJoinedPacket response;
-        recv(tcp_socket, &response, sizeof(response), 0);
         my_player_id = response.player_id;
+        tick_rate = std::max(MIN_TICK_RATE, std::min(MAX_TICK_RATE, (int)response.tick_rate));
+        session_token = response.session_token;
         
         std::cout << "Dołączono jako gracz " << my_player_id << std::endl;
         
-        // Uruchom wątki
-        network_thread = std::thread(&GameClient::network_loop, this);
-        input_thread = std::thread(&GameClient::input_loop, this);
+        if (!bind_udp()) {
+            // Serwer i tak pozna adres z pierwszego pakietu akcji albo potwierdzenia
+            std::cout << "Brak odpowiedzi na UDP_BIND - kontynuuję\n";
+        }
         
         return true;
     }
     
+    // Ogląda grę w pokoju jako widz. sync_rate ogranicza liczbę migawek na
+    // sekundę (0 - tyle co gracze), delay_ms opóźnia transmisję względem gry.
+    bool spectate(const std::string& room_name, int sync_rate, int delay_ms) {
+        if (!connected) return false;
+        
+        SpectatePacket packet{};
+        packet.server_name_length = std::min(room_name.length(), sizeof(packet.server_name) - 1);
+        memcpy(packet.server_name, room_name.c_str(), packet.server_name_length);
+        packet.sync_rate = sync_rate;
+        packet.delay_ms = delay_ms;
+        send_packet(packet);
+        
+        SpectateAcceptedPacket response;
+        if (!wait_for_packet(response) || response.session_token == 0) {
+            return false;
+        }
+        
+        spectator = true;
+        tick_rate = std::max(MIN_TICK_RATE, std::min(MAX_TICK_RATE, (int)response.tick_rate));
+        session_token = response.session_token;
+        // Bufor interpolacji musi objąć co najmniej dwa odstępy rzadszych migawek
+        interpolation.set_delay(std::max(interpolation.get_delay(), 2.0f * response.sync_interval_ms / 1000.0f));
+        
+        std::cout << "Oglądasz pokój (migawka co " << response.sync_interval_ms << " ms, opóźnienie "
+                  << response.delay_ms << " ms)" << std::endl;
+        
+        if (!bind_udp()) {
+            std::cout << "Brak odpowiedzi na UDP_BIND - kontynuuję\n";
+        }
+        return true;
+    }
+    
     void set_ready() {
         if (!connected) return;
         
-        uint8_t packet_type = PACKET_PLAYER_READY;
-        send(tcp_socket, &packet_type, 1, 0);
+        send_frame(PACKET_PLAYER_READY);
         
         std::cout << "Zaznaczono gotowość. Oczekiwanie na innych graczy...\n";
     }
     
     void disconnect() {
         if (connected) {
-            uint8_t packet_type = PACKET_PLAYER_LEAVE;
-            send(tcp_socket, &packet_type, 1, 0);
+            send_frame(PACKET_PLAYER_LEAVE);
             
             connected = false;
             game_active = false;
             
-            if (network_thread.joinable()) network_thread.join();
-            if (input_thread.joinable()) input_thread.join();
-            
             close(tcp_socket);
             close(udp_socket);
         }
+        if (tick_timer >= 0) {
+            close(tick_timer);
+            tick_timer = -1;
+        }
     }
     
-    void wait_for_game() {
-        while (connected && !game_active) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // Pętla zdarzeń klienta: jeden poll na klawiaturze, TCP, UDP i timerze taktu.
+    // Klawisz jest wysyłany zaraz po odczycie, a migawka stosowana zaraz po odebraniu;
+    // symulacja i rysowanie idą w takt timerfd. Bez wątków i bez aktywnego czekania -
+    // przed startem gry poll czeka tylko na gniazda.
+    void run() {
+        tick_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (tick_timer < 0) {
+            std::cerr << "Błąd tworzenia timerfd\n";
+            return;
         }
         
-        if (game_active) {
-            game_loop();
+        running = true;
+        process_frames();
+        while (connected && running) {
+            // Klawiatura dopiero po przejściu w tryb ncurses (wcześniej terminal czyta linie)
+            pollfd fds[4] = {
+                {screen_active ? STDIN_FILENO : -1, POLLIN, 0},
+                {tcp_socket, (short)(tcp_out.pending() ? POLLIN | POLLOUT : POLLIN), 0},
+                {udp_socket, POLLIN, 0},
+                {tick_timer, POLLIN, 0}
+            };
+            if (poll(fds, 4, -1) < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("Błąd poll: " << strerror(errno));
+                break;
+            }
+            
+            if (fds[2].revents & POLLIN) {
+                handle_udp_messages();
+            }
+            if (fds[1].revents & POLLOUT) {
+                tcp_out.flush(tcp_socket);
+            }
+            if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                handle_tcp_messages();
+            }
+            if (fds[0].revents & POLLIN) {
+                handle_keys();
+            }
+            if (fds[3].revents & POLLIN) {
+                uint64_t expirations;
+                if (read(tick_timer, &expirations, sizeof(expirations)) > 0) {
+                    // Nadrób pominięte takty (ograniczone, jak na serwerze)
+                    game_tick((int)std::min<uint64_t>(expirations, MAX_CATCHUP_TICKS));
+                }
+            }
+        }
+        
+        if (screen_active) {
+            endwin();
+            screen_active = false;
+        }
+        if (!end_summary.empty()) {
+            std::cout << end_summary;
         }
     }
     
 private:
-    void network_loop() {
-        while (connected) {
-            uint8_t packet_type;
-            int bytes = recv(tcp_socket, &packet_type, 1, MSG_DONTWAIT);
+    // Komunikat TCP w ramce (framing.h). Zwykle mieści się w buforze gniazda od razu;
+    // resztę wysyła pętla zdarzeń, gdy gniazdo przyjmie dane (POLLOUT).
+    void send_frame(uint8_t type, const void* payload = nullptr, size_t length = 0) {
+        tcp_out.queue(type, payload, length);
+        tcp_out.flush(tcp_socket);
+    }
+    
+    // Komunikat zakodowany według schematu (wire.h)
+    template <typename P>
+    void send_packet(const P& packet) {
+        uint8_t buffer[WIRE_MAX_SIZE<P>];
+        send_frame(WireSchema<P>::type, buffer, wire_encode(packet, buffer));
+    }
+    
+    // Pierwszy komunikat połączenia: zakres obsługiwanych wersji protokołu
+    bool negotiate_version() {
+        send_packet(HelloPacket{PROTOCOL_VERSION, PROTOCOL_MIN_VERSION});
+        
+        HelloAckPacket response;
+        if (!wait_for_packet(response)) {
+            std::cerr << "Brak odpowiedzi serwera na HELLO\n";
+            return false;
+        }
+        if (response.version == 0) {
+            std::cerr << "Niezgodna wersja protokołu: serwer obsługuje " << response.server_min_version << "-"
+                      << response.server_version << ", klient " << PROTOCOL_MIN_VERSION << "-"
+                      << PROTOCOL_VERSION << "\n";
+            return false;
+        }
+        LOG_INFO("Protokół w wersji " << response.version);
+        return true;
+    }
+    
+    // Oczekiwanie na odpowiedź serwera przed uruchomieniem pętli zdarzeń
+    template <typename P>
+    bool wait_for_packet(P& packet) {
+        Frame frame;
+        while (!tcp_in.next(frame)) {
+            if (tcp_in.is_broken()) return false;
             
-            if (bytes <= 0) {
-                // Sprawdź UDP
-                handle_udp_messages();
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                continue;
+            pollfd pfd{tcp_socket, (short)(tcp_out.pending() ? POLLIN | POLLOUT : POLLIN), 0};
+            if (poll(&pfd, 1, -1) < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            if (pfd.revents & POLLOUT) {
+                tcp_out.flush(tcp_socket);
             }
+            if ((pfd.revents & (POLLIN | POLLHUP | POLLERR)) && tcp_in.fill(tcp_socket) == FRAME_IO_CLOSED) {
+                return false;
+            }
+        }
+        return frame.type == WireSchema<P>::type && wire_decode(frame.payload, frame.length, packet);
+    }
+    
+    // Czyta, co przyszło, i obsługuje wszystkie kompletne ramki
+    void handle_tcp_messages() {
+        if (tcp_in.fill(tcp_socket) == FRAME_IO_CLOSED) {
+            LOG_INFO("Serwer zamknął połączenie");
+            running = false;
+            return;
+        }
+        process_frames();
+    }
             
-            switch (packet_type) {
-                case PACKET_READY_PROPAGATION:
-                    handle_ready_propagation();
+    // Obsługuje ramki z bufora - także te, które przyszły razem z odpowiedzią
+    // na dołączenie (np. GAME_START dla widza), zanim ruszyła pętla zdarzeń
+    void process_frames() {
+        Frame frame;
+        while (running && tcp_in.next(frame)) {
+            switch (frame.type) {
+                case PACKET_READY_PROPAGATION: {
+                    ReadyPropagationPacket packet;
+                    if (wire_decode(frame.payload, frame.length, packet)) handle_ready_propagation(&packet);
                     break;
+                }
                 case PACKET_GAME_START:
                     handle_game_start();
                     break;
-                case PACKET_GAME_END:
-                    handle_game_end();
+                case PACKET_GAME_END: {
+                    GameEndPacket packet;
+                    if (wire_decode(frame.payload, frame.length, packet)) handle_game_end(&packet);
+                    break;
+                }
+                case PACKET_PLAYER_LEFT: {
+                    PlayerLeftPacket packet;
+                    if (wire_decode(frame.payload, frame.length, packet)) handle_player_left(&packet);
                     break;
-                case PACKET_PLAYER_LEFT:
-                    handle_player_left();
+                }
+                default:
+                    LOG_WARN("Nieznany typ komunikatu TCP: " << (int)frame.type);
                     break;
             }
+        }
 
-            logToFile("dostal pakiet");
+        if (tcp_in.is_broken()) {
+            LOG_ERROR("Niepoprawna ramka od serwera - rozłączanie");
+            running = false;
         }
     }
     
+    // Odbiera wszystkie oczekujące datagramy
     void handle_udp_messages() {
         char buffer[1024];
-        sockaddr_in from_addr;
-        socklen_t addr_len = sizeof(from_addr);
-        
-        int bytes = recvfrom(udp_socket, buffer, sizeof(buffer), MSG_DONTWAIT,
-                           (sockaddr*)&from_addr, &addr_len);
-        
-        if (bytes <= 0) return;
+        int bytes;
+        while ((bytes = recv(udp_socket, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            handle_udp_datagram(buffer, bytes);
+        }
+    }
         
+    void handle_udp_datagram(const char* buffer, int bytes) {
         // POPRAWKA: Dodaj więcej logowania
-        logToFile("Otrzymano wiadomość UDP, rozmiar: " + std::to_string(bytes));
+        LOG_DEBUG("Otrzymano wiadomość UDP, rozmiar: " << bytes);
         
         if (bytes < sizeof(uint8_t)) {
-            logToFile("Za mała wiadomość UDP");
+            LOG_WARN("Za mała wiadomość UDP");
             return;
         }
         
         uint8_t packet_type = buffer[0];
-        logToFile("Typ pakietu UDP: " + std::to_string((int)packet_type));
+        LOG_DEBUG("Typ pakietu UDP: " << (int)packet_type);
         
         switch (packet_type) {
-            case PACKET_ACTION_PROPAGATION:
-                if (bytes >= sizeof(uint8_t) + sizeof(ActionPropagationPacket)) {
-                    handle_action_propagation((ActionPropagationPacket*)(buffer + 1));
-                    logToFile("Obsłużono propagację akcji");
+            case PACKET_ACTION_PROPAGATION: {
+                ActionPropagationPacket packet;
+                if (wire_decode((const uint8_t*)buffer + 1, bytes - 1, packet)) {
+                    handle_action_propagation(&packet);
+                    LOG_DEBUG("Obsłużono propagację akcji");
                 } else {
-                    logToFile("Za mały pakiet dla propagacji akcji");
+                    LOG_WARN("Za mały pakiet dla propagacji akcji");
                 }
                 break;
+            }
             case PACKET_GAME_SYNC:
-                if (bytes >= sizeof(uint8_t) + sizeof(GameSyncPacket)) {
-                    logToFile("Handluje game sync");
-                    handle_game_sync((GameSyncPacket*)(buffer + 1));
-                } else {
-                    logToFile("Za mały pakiet dla game sync");
-                }
+                LOG_DEBUG("Handluje game sync");
+                handle_game_sync((uint8_t*)(buffer + 1), bytes - 1);
                 break;
+            case PACKET_UDP_BIND_ACK:
+                break;  // spóźnione potwierdzenie powtórzonego UDP_BIND
             default:
-                logToFile("Nieznany typ pakietu UDP: " + std::to_string((int)packet_type));
+                LOG_WARN("Nieznany typ pakietu UDP: " << (int)packet_type);
                 break;
         }
     }
     
-    void handle_ready_propagation() {
-        ReadyPropagationPacket packet;
-        recv(tcp_socket, &packet, sizeof(packet), 0);
-        
-        std::cout << "Gracz " << packet.player_id << " jest gotowy\n";
+    void handle_ready_propagation(const ReadyPropagationPacket* packet) {
+        std::cout << "Gracz " << packet->player_id << " jest gotowy\n";
     }
     
     void handle_game_start() {
-        std::lock_guard<std::mutex> lock(state_mutex);
         game_active = true;
         game_state.game_running = true;
+        interpolation.reset(tick_rate);
         
         std::cout << "Gra rozpoczęta!\n";
         std::cout << "Sterowanie: strzałki lewo/prawo lub A/D\n";
         std::cout << "Naciśnij SPACE aby być gotowym do wyjścia\n";
+        
+        // Od teraz ekran gry i takt klienta (ten sam krok co na serwerze)
+        init_screen();
+        itimerspec tick_spec{};
+        tick_spec.it_interval.tv_nsec = 1000000000L / tick_rate;
+        tick_spec.it_value = tick_spec.it_interval;
+        timerfd_settime(tick_timer, 0, &tick_spec, nullptr);
     }
     
-    void handle_action_propagation(ActionPropagationPacket* packet) {
-        std::lock_guard<std::mutex> lock(state_mutex);
+    void handle_action_propagation(const ActionPropagationPacket* packet) {
+        if (packet->player_id < 0 || packet->player_id >= 4) return;
+        
+        // Powtórzone albo przestawione propagacje są pomijane
+        uint32_t& last_seq = remote_input_seq[packet->player_id];
+        if (last_seq != 0 && (int32_t)(packet->input_seq - last_seq) <= 0) return;
+        last_seq = packet->input_seq;
+        
         if (game_state.game_running && packet->player_id != my_player_id) {
             game_state.paddles[packet->player_id].set_action((PlayerAction)packet->action);
         }
     }
     
-    void handle_game_sync(GameSyncPacket* packet) {
-        std::lock_guard<std::mutex> lock(state_mutex);
+    void handle_game_sync(const uint8_t* data, size_t length) {
+        Snapshot snapshot;
+        SnapshotInput input;
+        if (!decode_snapshot(data, length, snapshots, snapshot, input)) {
+            // Uszkodzony pakiet albo różnica względem migawki, której już nie mamy -
+            // serwer wyśle pełną migawkę, gdy baza wypadnie z jego historii
+            LOG_DEBUG("Nie można zdekodować game sync");
+            return;
+        }
         
-        logToFile("pozycja pilki:" + std::to_string(packet->ball_x) + " " + std::to_string(packet->ball_y));
-        game_state.ball.x = packet->ball_x;
-        game_state.ball.y = packet->ball_y;
-        game_state.ball.velocity_x = packet->ball_velocity_x;
-        game_state.ball.velocity_y = packet->ball_velocity_y;
+        snapshots.put(snapshot);
+        if (!spectator) {
+            send_snapshot_ack(snapshot.seq);
+        }
         
+        InterpolationBuffer::Frame frame;
+        frame.ball_x = dequantize(snapshot.fields[FIELD_BALL_X]);
+        frame.ball_y = dequantize(snapshot.fields[FIELD_BALL_Y]);
+        frame.ball_vx = dequantize(snapshot.fields[FIELD_BALL_VX]);
+        frame.ball_vy = dequantize(snapshot.fields[FIELD_BALL_VY]);
         for (int i = 0; i < 4; i++) {
-            game_state.paddles[i].position = packet->paddle_positions[i];
-            game_state.scores[i] = packet->scores[i];
+            frame.paddles[i] = dequantize(snapshot.fields[FIELD_PADDLE_0 + i]);
+        }
+        LOG_DEBUG("pozycja pilki:" << frame.ball_x << " " << frame.ball_y);
+        
+        // Kulka i cudze platformy trafiają do bufora - także migawki przestawione
+        interpolation.push(snapshot.tick, frame, InterpolationBuffer::clock::now());
+        
+        // Wyniki i własna platforma tylko z najnowszej migawki
+        if (has_snapshot && !seq_newer(snapshot.seq, last_snapshot)) return;
+        has_snapshot = true;
+        last_snapshot = snapshot.seq;
+        
+        for (int i = 0; i < 4; i++) {
+            game_state.scores[i] = snapshot.scores[i];
+        }
+        if (my_player_id >= 0 && my_player_id < 4) {
+            reconcile_paddle(frame.paddles[my_player_id], input);
+        }
+    }
+        
+    // Ustawia kulkę i cudze platformy na stan z bufora interpolacji
+    void apply_interpolation() {
+        InterpolationBuffer::Frame frame;
+        if (!interpolation.sample(InterpolationBuffer::clock::now(), frame)) return;
+        
+        game_state.ball.x = frame.ball_x;
+        game_state.ball.y = frame.ball_y;
+        game_state.ball.velocity_x = frame.ball_vx;
+        game_state.ball.velocity_y = frame.ball_vy;
+        for (int i = 0; i < 4; i++) {
+            if (i != my_player_id) game_state.paddles[i].position = frame.paddles[i];
         }
     }
     
-    void handle_game_end() {
-        GameEndPacket packet;
-        recv(tcp_socket, &packet, sizeof(packet), 0);
+    // Uzgadnia przewidywaną pozycję własnej platformy z pozycją serwera:
+    // bierze pozycję z migawki i odtwarza na niej wejścia, których serwer
+    // jeszcze nie uwzględnił.
+    void reconcile_paddle(float server_position, const SnapshotInput& input) {
+        Paddle& paddle = game_state.paddles[my_player_id];
+        
+        const PendingInput* acked = find_input(input.input_seq);
+        if (!acked) {
+            // Serwer nie zastosował jeszcze żadnego z naszych wejść - bez
+            // wejść w locie jego pozycja jest dokładna, inaczej zostaje predykcja
+            if (next_input_seq == 1) paddle.position = server_position;
+            return;
+        }
+        if ((int32_t)(acked->seq - acked_input_seq) > 0) acked_input_seq = acked->seq;
         
-        std::lock_guard<std::mutex> lock(state_mutex);
+        // Migawka odpowiada lokalnemu taktowi acked->tick + input_age + 1
+        int64_t tick = acked->tick + input.input_age + 1;
+        if (tick > local_tick) {
+            paddle.position = server_position;
+            return;
+        }
+        
+        Paddle replay = paddle;
+        replay.position = server_position;
+        replay.set_action(acked->action);
+        
+        float dt = 1.0f / tick_rate;
+        uint32_t seq = acked->seq + 1;
+        for (; tick < local_tick; tick++) {
+            // Wejścia zastosowane lokalnie przed tym taktem
+            while (seq != next_input_seq && inputs[seq % INPUT_HISTORY].tick <= tick) {
+                replay.set_action(inputs[seq % INPUT_HISTORY].action);
+                seq++;
+            }
+            replay.update(dt);
+        }
+        
+        paddle.position = replay.position;
+    }
+    
+    const PendingInput* find_input(uint16_t seq16) const {
+        // Szukamy wśród ostatnich INPUT_HISTORY wejść po młodszych 16 bitach
+        for (uint32_t seq = next_input_seq - 1; seq != 0 && next_input_seq - seq <= INPUT_HISTORY; seq--) {
+            if ((uint16_t)seq == seq16) return &inputs[seq % INPUT_HISTORY];
+        }
+        return nullptr;
+    }
+    
+    // Zapisuje wejście w historii i stosuje je lokalnie
+    uint32_t record_input(PlayerAction action) {
+        uint32_t seq = next_input_seq++;
+        inputs[seq % INPUT_HISTORY] = PendingInput{seq, action, local_tick};
+        game_state.paddles[my_player_id].set_action(action);
+        return seq;
+    }
+    
+    void send_snapshot_ack(uint16_t seq) {
+        SnapshotAckPacket packet;
+        packet.session_token = session_token;
+        packet.snapshot_seq = seq;
+        uint8_t buffer[1 + WIRE_MAX_SIZE<SnapshotAckPacket>];
+        size_t length = wire_encode_datagram(packet, buffer);
+        
+        sendto(udp_socket, buffer, length, 0,
+               (sockaddr*)&server_addr, sizeof(server_addr));
+    }
+    
+    void handle_game_end(const GameEndPacket* packet) {
         game_active = false;
         game_state.game_running = false;
+        running = false;
         
-        std::cout << "\n=== KONIEC GRY ===\n";
-        for (int i = 0; i < packet.scores_len; i++) {
-            std::cout << "Gracz " << packet.scores[i].player_id 
-                      << ": " << packet.scores[i].score << " punktów\n";
+        // Wyniki są wypisywane po zamknięciu ekranu gry
+        end_summary = "\n=== KONIEC GRY ===\n";
+        for (int i = 0; i < std::min<int>(packet->scores_len, 4); i++) {
+            end_summary += "Gracz " + std::to_string(packet->scores[i].player_id) + ": "
+                         + std::to_string(packet->scores[i].score) + " punktów\n";
         }
     }
     
-    void handle_player_left() {
-        PlayerLeftPacket packet;
-        recv(tcp_socket, &packet, sizeof(packet), 0);
-        
-        std::cout << "Gracz " << packet.player_id << " opuścił grę\n";
+    // Zgłasza serwerowi adres UDP klienta (token sesji w UDP_BIND) i czeka na
+    // UDP_BIND_ACK, ponawiając co UDP_BIND_TIMEOUT_MS. Wywoływane przed pętlą zdarzeń.
+    bool bind_udp() {
+        const int UDP_BIND_ATTEMPTS = 10;
+        const int UDP_BIND_TIMEOUT_MS = 200;
+        
+        uint8_t buffer[1 + WIRE_MAX_SIZE<UdpBindPacket>];
+        size_t length = wire_encode_datagram(UdpBindPacket{session_token}, buffer);
+        
+        for (int attempt = 0; attempt < UDP_BIND_ATTEMPTS; attempt++) {
+            sendto(udp_socket, buffer, length, 0,
+                   (sockaddr*)&server_addr, sizeof(server_addr));
+            
+            pollfd pfd{udp_socket, POLLIN, 0};
+            while (poll(&pfd, 1, UDP_BIND_TIMEOUT_MS) > 0) {
+                uint8_t reply[1024];
+                int bytes = recv(udp_socket, reply, sizeof(reply), MSG_DONTWAIT);
+                if (bytes >= 1 && reply[0] == PACKET_UDP_BIND_ACK) {
+                    LOG_INFO("Adres UDP zarejestrowany na serwerze");
+                    return true;
+                }
+            }
+        }
+        return false;
     }
     
-    void send_action(PlayerAction action) {
-        char buffer[sizeof(uint8_t) + sizeof(PlayerActionPacket)];
-        buffer[0] = PACKET_PLAYER_ACTION;
-        
-        PlayerActionPacket* packet = (PlayerActionPacket*)(buffer + 1);
-        packet->action = action;
+    void handle_player_left(const PlayerLeftPacket* packet) {
+        // W trakcie gry terminal należy do ekranu gry - komunikat tylko w logu
+        LOG_INFO("Gracz " << packet->player_id << " opuścił grę");
+        if (!screen_active) {
+            std::cout << "Gracz " << packet->player_id << " opuścił grę\n";
+        }
+    }
+    
+    // Wysyła najnowsze wejście razem z poprzednimi (INPUT_REDUNDANCY)
+    void send_inputs() {
+        uint32_t newest = next_input_seq - 1;
+        if (newest == 0) return;
+        
+        PlayerActionPacket packet;
+        packet.session_token = session_token;
+        packet.input_seq = newest;
+        packet.count = std::min<uint32_t>(INPUT_REDUNDANCY, newest);
+        for (int i = 0; i < INPUT_REDUNDANCY; i++) {
+            packet.actions[i] = i < packet.count ? inputs[(newest - i) % INPUT_HISTORY].action : ACTION_STOP;
+        }
+        uint8_t buffer[1 + WIRE_MAX_SIZE<PlayerActionPacket>];
+        size_t length = wire_encode_datagram(packet, buffer);
         
-        // POPRAWKA: Dodaj logowanie do debugowania
-        std::cout << "Wysyłanie akcji: " << (int)action << std::endl;
-        logToFile("Wysyłanie akcji UDP: " + std::to_string((int)action));
+        LOG_DEBUG("Wysyłanie akcji UDP: " << packet.actions[0] << " (nr " << newest << ")");
+        last_input_send = std::chrono::steady_clock::now();
         
-        int result = sendto(udp_socket, buffer, sizeof(buffer), 0,
+        int result = sendto(udp_socket, buffer, length, 0,
                            (sockaddr*)&server_addr, sizeof(server_addr));
         
         if (result < 0) {
             std::cerr << "Błąd wysyłania UDP: " << strerror(errno) << std::endl;
-            logToFile("Błąd wysyłania UDP: " + std::string(strerror(errno)));
+            LOG_ERROR("Błąd wysyłania UDP: " << strerror(errno));
         }
     }
     
-    void input_loop() {
+    void init_screen() {
+        if (screen_active) return;
+        
         // Inicjalizacja ncurses
         initscr();
         cbreak();
@@ -327,253 +687,215 @@ private:
             init_pair(4, COLOR_CYAN, COLOR_BLACK);    // Ramka
             init_pair(5, COLOR_MAGENTA, COLOR_BLACK); // Wyniki
         }
+        screen_active = true;
+    }
         
-        bool left_pressed = false, right_pressed = false;
+    // Obsługuje wszystkie wciśnięte klawisze; wejście wychodzi do serwera od razu
+    void handle_keys() {
+        int ch;
+        while ((ch = getch()) != ERR) {
+            if (ch == 27 || ch == 'q' || ch == 'Q') {  // ESC
+                running = false;
+                return;
+            }
+            if (!game_active || spectator) continue;
         
-        while (connected) {
-            int ch = getch();
+            PlayerAction action = ACTION_STOP;
+            bool send_update = false;
             
-            if (ch != ERR && game_active) {
-                PlayerAction action = ACTION_STOP;
-                bool send_update = false;
-                
-                switch (ch) {
-                    case 'a':
-                    case 'A':
-                    case KEY_LEFT:
-                        if (!left_pressed) {
-                            left_pressed = true;
-                            right_pressed = false;
-                            action = ACTION_MOVE_LEFT;
-                            send_update = true;
-                        }
-                        break;
-                    case 'd':
-                    case 'D':
-                    case KEY_RIGHT:
-                        if (!right_pressed) {
-                            right_pressed = true;
-                            left_pressed = false;
-                            action = ACTION_MOVE_RIGHT;
-                            send_update = true;
-                        }
-                        break;
-                    case ' ':
-                        if (left_pressed || right_pressed) {
-                            left_pressed = false;
-                            right_pressed = false;
-                            action = ACTION_STOP;
-                            send_update = true;
-                        }
-                        break;
-                    case 27: // ESC
-                    case 'q':
-                    case 'Q':
-                        connected = false;
-                        break;
-                }
-                
-                if (send_update) {
-                    send_action(action);
-                    
-                    // Zaktualizuj lokalnie
-                    std::lock_guard<std::mutex> lock(state_mutex);
-                    game_state.paddles[my_player_id].set_action(action);
-                }
+            switch (ch) {
+                case 'a':
+                case 'A':
+                case KEY_LEFT:
+                    if (!left_pressed) {
+                        left_pressed = true;
+                        right_pressed = false;
+                        action = ACTION_MOVE_LEFT;
+                        send_update = true;
+                    }
+                    break;
+                case 'd':
+                case 'D':
+                case KEY_RIGHT:
+                    if (!right_pressed) {
+                        right_pressed = true;
+                        left_pressed = false;
+                        action = ACTION_MOVE_RIGHT;
+                        send_update = true;
+                    }
+                    break;
+                case ' ':
+                    if (left_pressed || right_pressed) {
+                        left_pressed = false;
+                        right_pressed = false;
+                        action = ACTION_STOP;
+                        send_update = true;
+                    }
+                    break;
             }
             
-            std::this_thread::sleep_for(std::chrono::milliseconds(16));
-        }
+            if (send_update) {
+                LOG_DEBUG("Wysyłanie akcji: " << (int)action);
         
-        // Przywróć terminal
-        endwin();
+                // Zaktualizuj lokalnie od razu (predykcja), serwer potwierdzi w migawce
+                record_input(action);
+                send_inputs();
+            }
+        }
     }
     
-    void game_loop() {
-        auto last_time = std::chrono::steady_clock::now();
+    // Takt klienta (timerfd, ten sam krok co na serwerze - identyczne trajektorie
+    // przy tych samych danych)
+    void game_tick(int ticks) {
+        if (!game_active) return;
+        float dt = 1.0f / tick_rate;
+        
+        // Lokalnie symulowana jest tylko własna platforma (predykcja);
+        // kulka i pozostałe platformy pochodzą z bufora interpolacji
+        for (int t = 0; t < ticks; t++) {
+            if (!spectator) game_state.paddles[my_player_id].update(dt);
+            local_tick++;
+        }
+        apply_interpolation();
         
-        while (connected && game_active) {
-            auto current_time = std::chrono::steady_clock::now();
-            float dt = std::chrono::duration<float>(current_time - last_time).count();
-            last_time = current_time;
-            
-            // Aktualizuj lokalny stan
-            {
-                std::lock_guard<std::mutex> lock(state_mutex);
-                game_state.update(dt);
-            }
-            
-            // Wyrenderuj grę
-            render_game();
-            
-            // 60 FPS
-            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        // Powtarzaj wejścia, dopóki serwer ich nie potwierdzi
+        if (acked_input_seq != next_input_seq - 1 &&
+            std::chrono::steady_clock::now() - last_input_send >= INPUT_RESEND_INTERVAL) {
+            send_inputs();
         }
+        
+        // Wyrenderuj grę
+        render_game();
     }
     
+    // Rysuje klatkę do bufora ekranu i wysyła tylko zmienione komórki
     void render_game() {
-        std::lock_guard<std::mutex> lock(state_mutex);
+        RenderView view;
+        view.ball_x = game_state.ball.x;
+        view.ball_y = game_state.ball.y;
+        for (int i = 0; i < 4; i++) {
+            view.paddles[i] = game_state.paddles[i].position;
+            view.scores[i] = game_state.scores[i];
+        }
         
         // Pobierz rozmiary terminala
         int max_y, max_x;
         getmaxyx(stdscr, max_y, max_x);
         
-        // Oblicz rozmiary areny (kwadratowa, ale dopasowana do terminala)
-        int arena_size = std::min(max_y - 4, (max_x - 4) / 2) * 2; // Parzysta szerokość dla lepszego wyglądu
-        int arena_height = arena_size / 2;
-        int arena_width = arena_size;
-        
-        int start_y = (max_y - arena_height) / 2;
-        int start_x = (max_x - arena_width) / 2;
-        
-        // Wyczyść ekran
-        clear();
-        
-        // Ramka areny z kolorami
-        if (has_colors()) attron(COLOR_PAIR(4));
-        
-        // Górna i dolna ramka
-        for (int x = 0; x < arena_width; x++) {
-            mvaddch(start_y, start_x + x, '-');
-            mvaddch(start_y + arena_height - 1, start_x + x, '-');
+        // Ramka i napisy są rysowane od nowa tylko po zmianie rozmiaru lub wyników
+        if (screen.resize(max_y, max_x) || view.scores != drawn_scores) {
+            draw_background(view.scores);
+            drawn_scores = view.scores;
+        } else {
+            screen.restore_layer();
         }
         
-        // Lewa i prawa ramka
-        for (int y = 0; y < arena_height; y++) {
-            mvaddch(start_y + y, start_x, '|');
-            mvaddch(start_y + y, start_x + arena_width - 1, '|');
-        }
-        
-        // Rogi
-        mvaddch(start_y, start_x, '+');
-        mvaddch(start_y, start_x + arena_width - 1, '+');
-        mvaddch(start_y + arena_height - 1, start_x, '+');
-        mvaddch(start_y + arena_height - 1, start_x + arena_width - 1, '+');
-        
-        if (has_colors()) attroff(COLOR_PAIR(4));
-        
         // Narysuj platformy
         for (int i = 0; i < 4; i++) {
-            const auto& paddle = game_state.paddles[i];
-            
-            // Oblicz pozycję platformy
-            int paddle_start = (int)((paddle.position - paddle.size/2) * arena_width / ARENA_SIZE);
-            int paddle_end = (int)((paddle.position + paddle.size/2) * arena_width / ARENA_SIZE);
-            
-            paddle_start = std::max(1, std::min(arena_width - 2, paddle_start));
-            paddle_end = std::max(1, std::min(arena_width - 2, paddle_end));
-            
-            // Wybierz kolor i znak
-            char paddle_char;
-            int color_pair;
-            
-            if (i == my_player_id) {
-                paddle_char = '#';
-                color_pair = 1; // Czerwony dla nas
-            } else {
-                paddle_char = '=';
-                color_pair = 2; // Zielony dla innych
-            }
-            
-            if (has_colors()) attron(COLOR_PAIR(color_pair));
-            
-            switch (paddle.wall) {
-                case WALL_NORTH: // Górna ściana
-                    for (int x = paddle_start; x <= paddle_end; x++) {
-                        mvaddch(start_y + 1, start_x + x, paddle_char);
-                    }
-                    break;
-                    
-                case WALL_SOUTH: // Dolna ściana
-                    for (int x = paddle_start; x <= paddle_end; x++) {
-                        mvaddch(start_y + arena_height - 2, start_x + x, paddle_char);
-                    }
-                    break;
-                    
-                case WALL_WEST: // Lewa ściana
-                    {
-                        int paddle_start_y = (int)((paddle.position - paddle.size/2) * arena_height / ARENA_SIZE);
-                        int paddle_end_y = (int)((paddle.position + paddle.size/2) * arena_height / ARENA_SIZE);
-                        
-                        paddle_start_y = std::max(1, std::min(arena_height - 2, paddle_start_y));
-                        paddle_end_y = std::max(1, std::min(arena_height - 2, paddle_end_y));
-                        
-                        for (int y = paddle_start_y; y <= paddle_end_y; y++) {
-                            mvaddch(start_y + y, start_x + 1, paddle_char);
-                        }
-                    }
-                    break;
-                    
-                case WALL_EAST: // Prawa ściana
-                    {
-                        int paddle_start_y = (int)((paddle.position - paddle.size/2) * arena_height / ARENA_SIZE);
-                        int paddle_end_y = (int)((paddle.position + paddle.size/2) * arena_height / ARENA_SIZE);
-                        
-                        paddle_start_y = std::max(1, std::min(arena_height - 2, paddle_start_y));
-                        paddle_end_y = std::max(1, std::min(arena_height - 2, paddle_end_y));
-                        
-                        for (int y = paddle_start_y; y <= paddle_end_y; y++) {
-                            mvaddch(start_y + y, start_x + arena_width - 2, paddle_char);
-                        }
-                    }
-                    break;
-            }
-            
-            if (has_colors()) attroff(COLOR_PAIR(color_pair));
+            draw_paddle(i, view.paddles[i]);
         }
         
         // Narysuj kulkę
-        int ball_x = (int)(game_state.ball.x * arena_width / ARENA_SIZE);
-        int ball_y = (int)(game_state.ball.y * arena_height / ARENA_SIZE);
+        int ball_x = (int)(view.ball_x * arena_width / ARENA_SIZE);
+        int ball_y = (int)(view.ball_y * arena_height / ARENA_SIZE);
         
         ball_x = std::max(1, std::min(arena_width - 2, ball_x));
         ball_y = std::max(1, std::min(arena_height - 2, ball_y));
+        screen.put(arena_y + ball_y, arena_x + ball_x, 'O', 3);
+        
+        screen.present();
+    }
+    
+    // Warstwa tła: ramka areny, tytuł, wyniki, sterowanie i oznaczenia graczy
+    void draw_background(const std::array<int, 4>& scores) {
+        int max_y = screen.height();
+        int max_x = screen.width();
         
-        if (has_colors()) attron(COLOR_PAIR(3));
-        mvaddch(start_y + ball_y, start_x + ball_x, 'O');
-        if (has_colors()) attroff(COLOR_PAIR(3));
+        // Oblicz rozmiary areny (kwadratowa, ale dopasowana do terminala)
+        int arena_size = std::min(max_y - 4, (max_x - 4) / 2) * 2; // Parzysta szerokość dla lepszego wyglądu
+        arena_height = arena_size / 2;
+        arena_width = arena_size;
         
-        // Wyświetl tytuł gry
-        std::string title = "=== THE 4PONG ===";
-        mvprintw(0, (max_x - title.length()) / 2, "%s", title.c_str());
+        arena_y = (max_y - arena_height) / 2;
+        arena_x = (max_x - arena_width) / 2;
         
-        // Wyświetl wyniki z kolorami
-        if (has_colors()) attron(COLOR_PAIR(5));
+        screen.clear_cells();
         
-        std::string scores_text = "Wyniki: ";
-        for (int i = 0; i < 4; i++) {
-            scores_text += "Gracz " + std::to_string(i) + ": " + std::to_string(game_state.scores[i]);
-            if (i < 3) scores_text += " | ";
+        // Górna i dolna ramka
+        for (int x = 0; x < arena_width; x++) {
+            screen.put(arena_y, arena_x + x, '-', 4);
+            screen.put(arena_y + arena_height - 1, arena_x + x, '-', 4);
         }
-        mvprintw(max_y - 3, (max_x - scores_text.length()) / 2, "%s", scores_text.c_str());
         
-        // Informacje o sterowaniu
-        std::string controls = "Twój ID: " + std::to_string(my_player_id) + " | A/D lub Strzałki | SPACE-stop | Q-wyjście";
-        mvprintw(max_y - 2, (max_x - controls.length()) / 2, "%s", controls.c_str());
+        // Lewa i prawa ramka
+        for (int y = 0; y < arena_height; y++) {
+            screen.put(arena_y + y, arena_x, '|', 4);
+            screen.put(arena_y + y, arena_x + arena_width - 1, '|', 4);
+        }
         
-        if (has_colors()) attroff(COLOR_PAIR(5));
+        // Rogi
+        screen.put(arena_y, arena_x, '+', 4);
+        screen.put(arena_y, arena_x + arena_width - 1, '+', 4);
+        screen.put(arena_y + arena_height - 1, arena_x, '+', 4);
+        screen.put(arena_y + arena_height - 1, arena_x + arena_width - 1, '+', 4);
+        
+        // Tytuł gry
+        const char* title = "=== THE 4PONG ===";
+        screen.text(0, (max_x - (int)strlen(title)) / 2, title);
+        
+        // Wyniki i sterowanie
+        char scores_text[128];
+        snprintf(scores_text, sizeof(scores_text), "Wyniki: Gracz 0: %d | Gracz 1: %d | Gracz 2: %d | Gracz 3: %d",
+                 scores[0], scores[1], scores[2], scores[3]);
+        screen.text(max_y - 3, (max_x - (int)strlen(scores_text)) / 2, scores_text, 5);
+            
+        // Komórka to jeden znak ASCII - ncurses bez locale wypisywał polskie litery
+        // jako sekwencje M-x, więc napisy na ekranie gry są bez nich
+        char controls[128];
+        if (spectator) {
+            snprintf(controls, sizeof(controls), "Widz | Q-wyjscie");
+        } else {
+            snprintf(controls, sizeof(controls), "Twoj ID: %d | A/D lub Strzalki | SPACE-stop | Q-wyjscie", my_player_id);
+        }
+        screen.text(max_y - 2, (max_x - (int)strlen(controls)) / 2, controls, 5);
         
         // Oznaczenia graczy na rogach
-        if (has_colors()) attron(COLOR_PAIR(my_player_id == 0 ? 1 : 2));
-        mvprintw(start_y - 1, start_x + arena_width/2 - 3, "Gracz 0");
-        if (has_colors()) attroff(COLOR_PAIR(my_player_id == 0 ? 1 : 2));
+        screen.text(arena_y - 1, arena_x + arena_width/2 - 3, "Gracz 0", player_color(0));
+        screen.text(arena_y + arena_height/2, arena_x + arena_width + 1, "G", player_color(1));
+        screen.text(arena_y + arena_height/2 + 1, arena_x + arena_width + 1, "1", player_color(1));
+        screen.text(arena_y + arena_height, arena_x + arena_width/2 - 3, "Gracz 2", player_color(2));
+        screen.text(arena_y + arena_height/2, arena_x - 2, "G", player_color(3));
+        screen.text(arena_y + arena_height/2 + 1, arena_x - 2, "3", player_color(3));
+        
+        screen.save_layer();
+    }
         
-        if (has_colors()) attron(COLOR_PAIR(my_player_id == 1 ? 1 : 2));
-        mvprintw(start_y + arena_height/2, start_x + arena_width + 1, "G");
-        mvprintw(start_y + arena_height/2 + 1, start_x + arena_width + 1, "1");
-        if (has_colors()) attroff(COLOR_PAIR(my_player_id == 1 ? 1 : 2));
+    void draw_paddle(int player_id, float position) {
+        const Paddle& paddle = game_state.paddles[player_id];
+        // Czerwony '#' dla nas, zielony '=' dla innych
+        char paddle_char = player_id == my_player_id ? '#' : '=';
+        uint8_t color = player_color(player_id);
         
-        if (has_colors()) attron(COLOR_PAIR(my_player_id == 2 ? 1 : 2));
-        mvprintw(start_y + arena_height, start_x + arena_width/2 - 3, "Gracz 2");
-        if (has_colors()) attroff(COLOR_PAIR(my_player_id == 2 ? 1 : 2));
+        bool horizontal = paddle.wall == WALL_NORTH || paddle.wall == WALL_SOUTH;
+        int length = horizontal ? arena_width : arena_height;
+        int paddle_start = (int)((position - paddle.size/2) * length / ARENA_SIZE);
+        int paddle_end = (int)((position + paddle.size/2) * length / ARENA_SIZE);
         
-        if (has_colors()) attron(COLOR_PAIR(my_player_id == 3 ? 1 : 2));
-        mvprintw(start_y + arena_height/2, start_x - 2, "G");
-        mvprintw(start_y + arena_height/2 + 1, start_x - 2, "3");
-        if (has_colors()) attroff(COLOR_PAIR(my_player_id == 3 ? 1 : 2));
+        paddle_start = std::max(1, std::min(length - 2, paddle_start));
+        paddle_end = std::max(1, std::min(length - 2, paddle_end));
         
-        // Odśwież ekran
-        refresh();
+        for (int i = paddle_start; i <= paddle_end; i++) {
+            switch (paddle.wall) {
+                case WALL_NORTH: screen.put(arena_y + 1, arena_x + i, paddle_char, color); break;
+                case WALL_SOUTH: screen.put(arena_y + arena_height - 2, arena_x + i, paddle_char, color); break;
+                case WALL_WEST:  screen.put(arena_y + i, arena_x + 1, paddle_char, color); break;
+                case WALL_EAST:  screen.put(arena_y + i, arena_x + arena_width - 2, paddle_char, color); break;
+            }
+        }
+    }
+    
+    uint8_t player_color(int player_id) const {
+        return player_id == my_player_id ? 1 : 2;
     }
 };
 
@@ -588,13 +910,45 @@ int main(int argc, char* argv[]) {
         port = std::atoi(argv[2]);
     }
     
+    // Logi trafiają do pliku przez wątek zapisujący (zapis przy wyjściu z programu)
+    Logger::instance().start("log_client.txt");
+    
     GameClient client;
+    if (argc > 4) {
+        // Opóźnienie interpolacji w ms - większe wygładza gorsze łącza
+        client.set_interpolation_delay(std::max(0, std::atoi(argv[4])) / 1000.0f);
+    }
     
     if (!client.connect_to_server(server_ip, port)) {
         std::cerr << "Nie można połączyć z serwerem\n";
         return 1;
     }
     
+    std::string room_name;
+    if (argc > 3) {
+        room_name = argv[3];
+    } else {
+        std::cout << "Podaj nazwę pokoju (ENTER - szybka gra): ";
+        std::getline(std::cin, room_name);
+    }
+    
+    // Tryb widza: [pokój] [opóźnienie ms] widz [migawki/s] [opóźnienie transmisji ms]
+    if (argc > 5 && std::string(argv[5]) == "widz") {
+        int sync_rate = argc > 6 ? std::max(0, std::atoi(argv[6])) : 0;
+        int delay_ms = argc > 7 ? std::max(0, std::atoi(argv[7])) : 0;
+        if (!client.spectate(room_name, sync_rate, delay_ms)) {
+            std::cerr << "Nie można oglądać pokoju (nie istnieje)\n";
+            return 1;
+        }
+        client.run();
+        return 0;
+    }
+    
+    if (!client.join_room(room_name)) {
+        std::cerr << "Nie można dołączyć do pokoju (pełny lub gra już trwa)\n";
+        return 1;
+    }
+    
     std::string nick;
     std::cout << "Podaj nick (max 20 znaków): ";
     std::getline(std::cin, nick);
@@ -608,7 +962,7 @@ int main(int argc, char* argv[]) {
     std::cin.get();
     
     client.set_ready();
-    client.wait_for_game();
+    client.run();
     
     return 0;
 }
\ No newline at end of file
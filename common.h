@@ -19,9 +19,22 @@ enum PacketType : uint8_t {
     PACKET_GAME_END = 10,
     PACKET_PLAYER_LEAVE = 11,
     PACKET_PLAYER_LEFT = 12,
-    PACKET_GAME_SYNC = 13
+    PACKET_GAME_SYNC = 13,
+    PACKET_SNAPSHOT_ACK = 14,
+    PACKET_UDP_BIND = 15,
+    PACKET_UDP_BIND_ACK = 16,
+    PACKET_SPECTATE = 17,
+    PACKET_SPECTATE_ACCEPTED = 18,
+    PACKET_HELLO = 19,
+    PACKET_HELLO_ACK = 20
 };
 
+// Wersja protokołu (układ komunikatów w wire.h). Klient zaczyna połączenie TCP
+// od HELLO z zakresem obsługiwanych wersji, serwer wybiera najnowszą wspólną
+// albo odpowiada version = 0 i zamyka połączenie.
+const uint16_t PROTOCOL_VERSION = 1;
+const uint16_t PROTOCOL_MIN_VERSION = 1;
+
 // Akcje graczy
 enum PlayerAction : int32_t {
     ACTION_MOVE_LEFT = 0,
@@ -37,7 +50,18 @@ enum Wall : int32_t {
     WALL_WEST = 3    // Gracz 3 - lewo
 };
 
-// Struktury komunikatów
+// Struktury komunikatów (w pamięci - na łączu są kodowane według schematów z wire.h)
+struct HelloPacket {
+    uint16_t version;      // najnowsza wersja protokołu nadawcy
+    uint16_t min_version;  // najstarsza, którą jeszcze obsługuje
+};
+
+struct HelloAckPacket {
+    uint16_t version;             // uzgodniona wersja, 0 = brak wspólnej
+    uint16_t server_version;
+    uint16_t server_min_version;
+};
+
 struct CreateJoinServerPacket {
     int32_t server_name_length;
     char server_name[64];
@@ -56,19 +80,55 @@ struct PlayerJoinedPacket {
     int32_t player_id;
     int32_t nick_length;
     char nick[21];
+    int32_t tick_rate;  // częstotliwość symulacji serwera (takty/s)
+    uint64_t session_token;  // identyfikuje gracza w pakietach UDP
+};
+
+// Każdy pakiet UDP klienta zaczyna się od session_token z PLAYER_JOINED.
+// Serwer kieruje datagram do pokoju i gracza po tokenie (nie po adresie),
+// a adres nadawcy poprawnego pakietu staje się adresem UDP gracza.
+// UDP_BIND (klient -> serwer) jest powtarzany, aż przyjdzie UDP_BIND_ACK (bez danych).
+struct UdpBindPacket {
+    uint64_t session_token;
+};
+
+// Widz (zamiast CREATE_JOIN_SERVER): bez miejsca w pokoju, tylko odbiera migawki.
+// Token z SPECTATE_ACCEPTED rejestruje adres przez UDP_BIND tak jak u gracza.
+// Migawki widzów są pełne (widz nic nie potwierdza) i mogą przychodzić rzadziej
+// oraz z opóźnieniem względem graczy.
+struct SpectatePacket {
+    int32_t server_name_length;  // 0 = dowolny pokój z szybkiej gry, najlepiej z trwającą grą
+    char server_name[64];
+    int32_t sync_rate;           // żądane migawki na sekundę (0 = tyle co gracze)
+    int32_t delay_ms;            // dodatkowe opóźnienie transmisji
+};
+
+struct SpectateAcceptedPacket {
+    int32_t tick_rate;
+    int32_t sync_interval_ms;  // przyznany odstęp między migawkami
+    int32_t delay_ms;          // przyznane opóźnienie
+    uint64_t session_token;    // 0 = nie ma takiego pokoju
 };
 
 struct ReadyPropagationPacket {
     int32_t player_id;
 };
 
+// Liczba ostatnich wejść powtarzanych w każdym pakiecie akcji - zgubiony
+// datagram jest odtwarzany z kolejnego bez retransmisji
+const int INPUT_REDUNDANCY = 4;
+
 struct PlayerActionPacket {
-    int32_t action;
+    uint64_t session_token;
+    uint32_t input_seq;                 // numer najnowszego wejścia (od 1)
+    int32_t count;                      // liczba wejść w pakiecie (1..INPUT_REDUNDANCY)
+    int32_t actions[INPUT_REDUNDANCY];  // actions[i] - wejście o numerze input_seq - i
 };
 
 struct ActionPropagationPacket {
     int32_t action;
     int32_t player_id;
+    uint32_t input_seq;
 };
 
 struct PlayerScore {
@@ -85,13 +145,12 @@ struct PlayerLeftPacket {
     int32_t player_id;
 };
 
-struct GameSyncPacket {
-    float ball_x;
-    float ball_y;
-    float ball_velocity_x;
-    float ball_velocity_y;
-    float paddle_positions[4];
-    int32_t scores[4];
+// GAME_SYNC ma format zmiennej długości - patrz snapshot.h
+
+// Potwierdzenie odebrania migawki (UDP, klient -> serwer)
+struct SnapshotAckPacket {
+    uint64_t session_token;
+    int32_t snapshot_seq;
 };
 
 // Stałe gry
@@ -101,11 +160,36 @@ const float BALL_RADIUS = 1.0f;
 const float PADDLE_SPEED = 50.0f;
 const float BALL_SPEED = 30.0f;
 const int INITIAL_SCORE = 5;
-const int GAME_FPS = 60;
+
+// Częstotliwość symulacji (takty na sekundę) - konfigurowalna po stronie serwera
+const int DEFAULT_TICK_RATE = 60;
+const int MIN_TICK_RATE = 10;
+const int MAX_TICK_RATE = 240;
+// Maksymalna liczba zaległych taktów nadrabianych naraz (po dłuższym zatrzymaniu
+// zaległy czas jest porzucany zamiast przyspieszać symulację)
+const int MAX_CATCHUP_TICKS = 5;
+// Częstotliwość wysyłania synchronizacji stanu (na sekundę)
+const int SYNC_RATE = 30;
 
 // Pozycje platform na ścianach
 const float PADDLE_OFFSET = 2.0f;
 
+// Maksymalna liczba odbić kulki obsługiwanych w jednym takcie
+const int MAX_BOUNCES_PER_TICK = 8;
+
+// Generator liczb losowych gry (splitmix64). Stan jest częścią stanu pokoju,
+// a nie globalnym rand(), więc ziarno i lista wejść wystarczają do odtworzenia
+// meczu bit w bit (powtórki), niezależnie od innych pokoi.
+const uint64_t DEFAULT_GAME_SEED = 1;
+
+inline uint64_t next_random(uint64_t& state) {
+    state += 0x9E3779B97F4A7C15ull;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
 // Klasa Ball
 class Ball {
 public:
@@ -177,10 +261,11 @@ public:
     bool game_running;
     std::array<bool, 4> players_ready;
     int active_players;
+    uint64_t rng_state;  // stan generatora losowego pokoju (kierunek kulki po resecie)
     
     GameState() : paddles{Paddle(WALL_NORTH, 0), Paddle(WALL_EAST, 1), 
                           Paddle(WALL_SOUTH, 2), Paddle(WALL_WEST, 3)},
-                  game_running(false), active_players(0) {
+                  game_running(false), active_players(0), rng_state(DEFAULT_GAME_SEED) {
         for(int i = 0; i < 4; i++) {
             scores[i] = INITIAL_SCORE;
             players_ready[i] = false;
@@ -195,49 +280,130 @@ public:
             paddle.update(dt);
         }
         
-        // Update ball
-        ball.update(dt);
-        
-        // Check collisions
-        check_collisions();
+        // Ruch kulki z ciągłą detekcją kolizji
+        move_ball(dt);
     }
     
-    void check_collisions() {
-        // Sprawdzanie kolizji w ustalonej kolejności (zgodnie z dokumentem)
-        for (int i = 0; i < 4; i++) {
-            if (check_paddle_collision(i)) {
-                handle_paddle_bounce(i);
+    // Przesuwa kulkę o dt, szukając po drodze pierwszego uderzenia (platforma lub ściana).
+    // Po odbiciu od platformy ruch jest kontynuowany przez pozostały czas, więc szybka
+    // kulka ani długi takt nie pozwalają jej przelecieć przez platformę lub ścianę.
+    void move_ball(float dt) {
+        float remaining = dt;
+        
+        for (int bounce = 0; bounce < MAX_BOUNCES_PER_TICK; bounce++) {
+            // Sprawdzanie kolizji w ustalonej kolejności (zgodnie z dokumentem) - przy
+            // równym czasie uderzenia wygrywa platforma o niższym id
+            int hit_paddle = -1;
+            float hit_time = remaining;
+            for (int i = 0; i < 4; i++) {
+                float t = paddle_time_of_impact(i, hit_time);
+                if (t >= 0 && (hit_paddle == -1 || t < hit_time)) {
+                    hit_paddle = i;
+                    hit_time = t;
+                }
+            }
+            
+            Wall hit_wall = WALL_NORTH;
+            float wall_time = wall_time_of_impact(hit_time, hit_wall);
+            
+            if (wall_time >= 0 && (hit_paddle == -1 || wall_time < hit_time)) {
+                // Kulka doleciała do ściany - gracz traci punkt
+                handle_wall_hit(hit_wall);
+                return;
+            }
+            
+            if (hit_paddle == -1) {
+                ball.update(remaining);
                 return;
             }
+            
+            ball.update(hit_time);
+            snap_to_paddle_line(hit_paddle);
+            handle_paddle_bounce(hit_paddle);
+            remaining -= hit_time;
         }
         
-        // Sprawdzanie kolizji ze ścianami
-        check_wall_collisions();
+        // Limit odbić wyczerpany - dokończ ruch bez dalszych kolizji z platformami
+        Wall hit_wall = WALL_NORTH;
+        if (wall_time_of_impact(remaining, hit_wall) >= 0) {
+            handle_wall_hit(hit_wall);
+        } else {
+            ball.update(remaining);
+        }
     }
     
-private:
-    bool check_paddle_collision(int paddle_id) {
+    // Czas (z przedziału [0, t_max]) w którym środek kulki dotknie linii platformy
+    // w obrębie platformy albo -1, gdy w tym czasie nie dojdzie do uderzenia.
+    // Liczą się tylko uderzenia od strony areny, gdy kulka leci w stronę ściany.
+    float paddle_time_of_impact(int paddle_id, float t_max) const {
         const Paddle& paddle = paddles[paddle_id];
+        float line = 0, position = 0, velocity = 0, along = 0, along_velocity = 0;
         
         switch(paddle.wall) {
             case WALL_NORTH:
-                return (ball.y - ball.radius <= PADDLE_OFFSET) &&
-                       (ball.x >= paddle.position - paddle.size/2) &&
-                       (ball.x <= paddle.position + paddle.size/2);
+                if (ball.velocity_y >= 0) return -1;
+                line = PADDLE_OFFSET + ball.radius;
+                position = ball.y; velocity = ball.velocity_y;
+                along = ball.x; along_velocity = ball.velocity_x;
+                break;
             case WALL_SOUTH:
-                return (ball.y + ball.radius >= ARENA_SIZE - PADDLE_OFFSET) &&
-                       (ball.x >= paddle.position - paddle.size/2) &&
-                       (ball.x <= paddle.position + paddle.size/2);
+                if (ball.velocity_y <= 0) return -1;
+                line = ARENA_SIZE - PADDLE_OFFSET - ball.radius;
+                position = ball.y; velocity = ball.velocity_y;
+                along = ball.x; along_velocity = ball.velocity_x;
+                break;
             case WALL_WEST:
-                return (ball.x - ball.radius <= PADDLE_OFFSET) &&
-                       (ball.y >= paddle.position - paddle.size/2) &&
-                       (ball.y <= paddle.position + paddle.size/2);
+                if (ball.velocity_x >= 0) return -1;
+                line = PADDLE_OFFSET + ball.radius;
+                position = ball.x; velocity = ball.velocity_x;
+                along = ball.y; along_velocity = ball.velocity_y;
+                break;
             case WALL_EAST:
-                return (ball.x + ball.radius >= ARENA_SIZE - PADDLE_OFFSET) &&
-                       (ball.y >= paddle.position - paddle.size/2) &&
-                       (ball.y <= paddle.position + paddle.size/2);
+                if (ball.velocity_x <= 0) return -1;
+                line = ARENA_SIZE - PADDLE_OFFSET - ball.radius;
+                position = ball.x; velocity = ball.velocity_x;
+                along = ball.y; along_velocity = ball.velocity_y;
+                break;
+        }
+        
+        float t = (line - position) / velocity;
+        if (t < 0 || t > t_max) return -1;
+        
+        float hit = along + along_velocity * t;
+        if (hit < paddle.position - paddle.size/2 || hit > paddle.position + paddle.size/2) return -1;
+        
+        return t;
+    }
+    
+    // Najwcześniejszy czas (z przedziału [0, t_max]) w którym środek kulki dotknie
+    // ściany albo -1; trafiona ściana zwracana w wall
+    float wall_time_of_impact(float t_max, Wall& wall) const {
+        float best = -1;
+        
+        auto consider = [&](float t, Wall w) {
+            if (t >= 0 && t <= t_max && (best < 0 || t < best)) {
+                best = t;
+                wall = w;
+            }
+        };
+        
+        if (ball.velocity_y < 0) consider((0 - ball.y) / ball.velocity_y, WALL_NORTH);
+        if (ball.velocity_y > 0) consider((ARENA_SIZE - ball.y) / ball.velocity_y, WALL_SOUTH);
+        if (ball.velocity_x < 0) consider((0 - ball.x) / ball.velocity_x, WALL_WEST);
+        if (ball.velocity_x > 0) consider((ARENA_SIZE - ball.x) / ball.velocity_x, WALL_EAST);
+        
+        return best;
+    }
+    
+private:
+    // Ustawia kulkę dokładnie na linii platformy (usuwa błąd zaokrąglenia po ruchu do punktu uderzenia)
+    void snap_to_paddle_line(int paddle_id) {
+        switch(paddles[paddle_id].wall) {
+            case WALL_NORTH: ball.y = PADDLE_OFFSET + ball.radius; break;
+            case WALL_SOUTH: ball.y = ARENA_SIZE - PADDLE_OFFSET - ball.radius; break;
+            case WALL_WEST:  ball.x = PADDLE_OFFSET + ball.radius; break;
+            case WALL_EAST:  ball.x = ARENA_SIZE - PADDLE_OFFSET - ball.radius; break;
         }
-        return false;
     }
     
     void handle_paddle_bounce(int paddle_id) {
@@ -269,36 +435,19 @@ private:
         }
     }
     
-    void check_wall_collisions() {
-        bool scored = false;
-        int scoring_player = -1;
+    void handle_wall_hit(Wall wall) {
+        // Gracz broniący trafionej ściany traci punkt (id gracza = numer ściany)
+        scores[wall]--;
         
-        // Kolizje ze ścianami
-        if (ball.y <= 0) {
-            scores[0]--;  // Gracz 0 traci punkt
-            scored = true;
-        } else if (ball.y >= ARENA_SIZE) {
-            scores[2]--;  // Gracz 2 traci punkt
-            scored = true;
-        } else if (ball.x <= 0) {
-            scores[3]--;  // Gracz 3 traci punkt
-            scored = true;
-        } else if (ball.x >= ARENA_SIZE) {
-            scores[1]--;  // Gracz 1 traci punkt
-            scored = true;
-        }
-        
-        if (scored) {
-            reset_ball();
-            check_game_end();
-        }
+        reset_ball();
+        check_game_end();
     }
     
     void reset_ball() {
         ball.x = ARENA_SIZE / 2;
         ball.y = ARENA_SIZE / 2;
-        ball.velocity_x =  0 ;//(rand() % 2 == 0 ? 1 : -1) * BALL_SPEED;
-        ball.velocity_y = (rand() % 2 == 0 ? 1 : -1) * BALL_SPEED;
+        ball.velocity_x =  0 ;//(next_random(rng_state) % 2 == 0 ? 1 : -1) * BALL_SPEED;
+        ball.velocity_y = (next_random(rng_state) % 2 == 0 ? 1 : -1) * BALL_SPEED;
     }
     
     void check_game_end() {
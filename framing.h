@@ -0,0 +1,215 @@
+#pragma once
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// Ramkowanie strumienia TCP: każdy komunikat to nagłówek
+//   u8 typ, u16 długość treści (little-endian)
+// i treść o tej długości. Odbiorca składa ramki z bufora niezależnie od tego,
+// jak strumień został podzielony na segmenty, więc częściowy odczyt nie rozsynchronizuje
+// protokołu, a nieznany typ ramki można pominąć po długości.
+//
+// Nadawca dopisuje ramki do pierścienia połączenia i wysyła wszystkie zaległe jednym
+// writev (nagłówek i treść w jednym segmencie, kilka komunikatów w jednym wywołaniu).
+// Gniazdo jest nieblokujące: wolny odbiorca zostawia dane w pierścieniu, a gdy ten się
+// zapełni, połączenie jest zrywane zamiast blokować wątek nadawcy.
+
+const size_t FRAME_HEADER_SIZE = 3;
+const size_t FRAME_MAX_PAYLOAD = 256;  // największa struktura protokołu ma 80 bajtów
+
+// Pierścień bajtów o pojemności będącej potęgą dwójki
+class ByteRing {
+public:
+    explicit ByteRing(size_t capacity_pow2) : data(capacity_pow2), mask(capacity_pow2 - 1), head(0), tail(0) {}
+    
+    size_t size() const { return tail - head; }
+    size_t capacity() const { return data.size(); }
+    size_t free_space() const { return capacity() - size(); }
+    bool empty() const { return head == tail; }
+    
+    // Dopisuje length bajtów; false (bez zmian), gdy się nie mieszczą
+    bool write(const void* src, size_t length) {
+        if (length > free_space()) return false;
+        const uint8_t* bytes = (const uint8_t*)src;
+        size_t offset = tail & mask;
+        size_t first = std::min(length, capacity() - offset);
+        memcpy(&data[offset], bytes, first);
+        memcpy(&data[0], bytes + first, length - first);
+        tail += length;
+        return true;
+    }
+    
+    // Kopiuje length bajtów od początku (bez zdejmowania)
+    void peek(void* dst, size_t length, size_t skip = 0) const {
+        uint8_t* bytes = (uint8_t*)dst;
+        size_t offset = (head + skip) & mask;
+        size_t first = std::min(length, capacity() - offset);
+        memcpy(bytes, &data[offset], first);
+        memcpy(bytes + first, &data[0], length - first);
+    }
+    
+    void consume(size_t length) { head += length; }
+    void commit(size_t length) { tail += length; }
+    void clear() { head = tail = 0; }
+    
+    // Zajęte bajty jako najwyżej dwa ciągłe fragmenty (do writev); zwraca ich liczbę
+    int readable(iovec iov[2]) {
+        return regions(head, size(), iov);
+    }
+    
+    // Wolne miejsce jako najwyżej dwa ciągłe fragmenty (do readv)
+    int writable(iovec iov[2]) {
+        return regions(tail, free_space(), iov);
+    }
+    
+private:
+    std::vector<uint8_t> data;
+    size_t mask;
+    size_t head, tail;  // liczniki rosnące bez końca, pozycja = licznik & mask
+    
+    int regions(size_t start, size_t length, iovec iov[2]) {
+        if (length == 0) return 0;
+        size_t offset = start & mask;
+        size_t first = std::min(length, capacity() - offset);
+        iov[0].iov_base = &data[offset];
+        iov[0].iov_len = first;
+        if (first == length) return 1;
+        iov[1].iov_base = &data[0];
+        iov[1].iov_len = length - first;
+        return 2;
+    }
+};
+
+// Ramka odczytana ze strumienia; treść jest wyrównana, więc można ją rzutować na strukturę
+struct Frame {
+    uint8_t type;
+    uint16_t length;
+    alignas(8) uint8_t payload[FRAME_MAX_PAYLOAD];
+};
+
+// Wynik odczytu z gniazda
+enum FrameIo {
+    FRAME_IO_AGAIN,   // nic więcej do odczytu/zapisu w tej chwili
+    FRAME_IO_OK,      // odczytano/wysłano dane
+    FRAME_IO_CLOSED   // koniec strumienia, błąd gniazda albo naruszenie protokołu
+};
+
+// Odbiór: bajty z gniazda trafiają do pierścienia, z którego są zdejmowane całe ramki
+class FrameReader {
+public:
+    explicit FrameReader(size_t capacity = 4096) : ring(capacity), broken(false) {}
+    
+    // Czyta z nieblokującego gniazda tyle, ile zmieści pierścień
+    FrameIo fill(int fd) {
+        iovec iov[2];
+        int count = ring.writable(iov);
+        if (count == 0) return FRAME_IO_AGAIN;  // najpierw trzeba zdjąć gotowe ramki
+        
+        while (true) {
+            ssize_t bytes = readv(fd, iov, count);
+            if (bytes > 0) {
+                ring.commit(bytes);
+                return FRAME_IO_OK;
+            }
+            if (bytes == 0) return FRAME_IO_CLOSED;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return FRAME_IO_AGAIN;
+            return FRAME_IO_CLOSED;
+        }
+    }
+    
+    // Zdejmuje kolejną kompletną ramkę; false, gdy brak (albo strumień uszkodzony - is_broken)
+    bool next(Frame& frame) {
+        if (!peek(frame)) return false;
+        ring.consume(FRAME_HEADER_SIZE + frame.length);
+        return true;
+    }
+    
+    // Jak next(), ale ramka zostaje w buforze (np. połączenie przekazywane innemu wątkowi)
+    bool peek(Frame& frame) {
+        if (broken || ring.size() < FRAME_HEADER_SIZE) return false;
+        
+        uint8_t header[FRAME_HEADER_SIZE];
+        ring.peek(header, sizeof(header));
+        size_t length = header[1] | (header[2] << 8);
+        if (length > FRAME_MAX_PAYLOAD) {
+            broken = true;
+            return false;
+        }
+        if (ring.size() < FRAME_HEADER_SIZE + length) return false;
+        
+        frame.type = header[0];
+        frame.length = (uint16_t)length;
+        ring.peek(frame.payload, length, FRAME_HEADER_SIZE);
+        return true;
+    }
+    
+    bool is_broken() const { return broken; }
+    size_t buffered() const { return ring.size(); }
+    
+    // Stan jak po utworzeniu, bez zwalniania pierścienia (ponowne użycie połączenia)
+    void clear() {
+        ring.clear();
+        broken = false;
+    }
+    
+private:
+    ByteRing ring;
+    bool broken;
+};
+
+// Nadawanie: ramki czekają w pierścieniu, flush wysyła wszystkie zaległe writev
+class FrameWriter {
+public:
+    explicit FrameWriter(size_t capacity = 16384) : ring(capacity), overflowed(false) {}
+    
+    // Dopisuje ramkę; przy braku miejsca oznacza przepełnienie (odbiorca nie nadąża)
+    bool queue(uint8_t type, const void* payload, size_t length) {
+        if (overflowed || length > FRAME_MAX_PAYLOAD || FRAME_HEADER_SIZE + length > ring.free_space()) {
+            overflowed = true;
+            return false;
+        }
+        uint8_t header[FRAME_HEADER_SIZE] = {type, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8)};
+        ring.write(header, sizeof(header));
+        if (length > 0) ring.write(payload, length);
+        return true;
+    }
+    
+    // Wysyła zaległe bajty bez blokowania
+    FrameIo flush(int fd) {
+        while (!ring.empty()) {
+            iovec iov[2];
+            int count = ring.readable(iov);
+            msghdr message{};
+            message.msg_iov = iov;
+            message.msg_iovlen = count;
+            // sendmsg zamiast writev - MSG_NOSIGNAL (bez SIGPIPE po zerwaniu połączenia)
+            ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent > 0) {
+                ring.consume(sent);
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return FRAME_IO_AGAIN;
+            return FRAME_IO_CLOSED;
+        }
+        return FRAME_IO_OK;
+    }
+    
+    bool pending() const { return !ring.empty(); }
+    bool has_overflowed() const { return overflowed; }
+    
+    void clear() {
+        ring.clear();
+        overflowed = false;
+    }
+    
+private:
+    ByteRing ring;
+    bool overflowed;
+};
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+#include "common.h"
+#include <deque>
+#include <chrono>
+#include <algorithm>
+
+// Bufor migawek po stronie klienta (jitter buffer). Kulka i cudze platformy są
+// rysowane z opóźnieniem INTERPOLATION_DELAY względem szacowanego czasu serwera,
+// interpolowane między dwiema sąsiednimi migawkami. Gdy kolejna migawka nie
+// dotarła, pozycja kulki jest ekstrapolowana z prędkości, ale nie dalej niż
+// MAX_EXTRAPOLATION - potem obraz zatrzymuje się do nadejścia danych.
+
+const float DEFAULT_INTERPOLATION_DELAY = 0.1f;  // sekundy (~3 migawki przy SYNC_RATE 30)
+const float MAX_EXTRAPOLATION = 0.1f;            // sekundy
+const int INTERPOLATION_FRAMES = 32;             // liczba buforowanych migawek
+// Rozjazd zegara większy niż ten (np. zatrzymanie serwera) ustawia oszacowanie od nowa
+const float CLOCK_SNAP_THRESHOLD = 0.25f;
+// Skok kulki większy niż ten między migawkami (reset po punkcie) nie jest interpolowany
+const float TELEPORT_DISTANCE = ARENA_SIZE / 4;
+
+class InterpolationBuffer {
+public:
+    using clock = std::chrono::steady_clock;
+    
+    struct Frame {
+        int64_t tick;  // takt serwera
+        float ball_x, ball_y;
+        float ball_vx, ball_vy;
+        float paddles[4];
+    };
+    
+    InterpolationBuffer() : tick_dt(1.0f / DEFAULT_TICK_RATE), delay(DEFAULT_INTERPOLATION_DELAY) {
+        reset(DEFAULT_TICK_RATE);
+    }
+    
+    void set_delay(float seconds) { delay = seconds; }
+    float get_delay() const { return delay; }
+    
+    // Czyści bufor (nowa gra); tick_rate - częstotliwość taktów serwera
+    void reset(int tick_rate) {
+        tick_dt = 1.0f / tick_rate;
+        frames.clear();
+        has_offset = false;
+        offset = 0.0;
+        origin = clock::now();
+    }
+    
+    // Dodaje migawkę; tick16 to młodsze 16 bitów taktu serwera z pakietu
+    void push(uint16_t tick16, Frame frame, clock::time_point arrival) {
+        frame.tick = unwrap(tick16);
+        
+        // Oszacowanie przesunięcia zegara: czas lokalny - czas serwera (wygładzane)
+        double sample = seconds(arrival) - frame.tick * (double)tick_dt;
+        if (!has_offset || std::fabs(sample - offset) > CLOCK_SNAP_THRESHOLD) {
+            offset = sample;
+            has_offset = true;
+        } else {
+            offset += (sample - offset) * 0.05;
+        }
+        
+        // Wstaw w kolejności taktów (migawki mogą przyjść przestawione)
+        auto it = frames.end();
+        while (it != frames.begin() && (it - 1)->tick > frame.tick) --it;
+        if (it != frames.begin() && (it - 1)->tick == frame.tick) return;  // duplikat
+        frames.insert(it, frame);
+        
+        while ((int)frames.size() > INTERPOLATION_FRAMES) frames.pop_front();
+    }
+    
+    // Stan do narysowania w chwili now; false gdy bufor jest pusty
+    bool sample(clock::time_point now, Frame& out) const {
+        if (frames.empty()) return false;
+        
+        double render_tick = (seconds(now) - offset - delay) / tick_dt;
+        
+        if (render_tick <= frames.front().tick) {
+            out = frames.front();
+            return true;
+        }
+        
+        if (render_tick >= frames.back().tick) {
+            // Brak nowszej migawki - ograniczona ekstrapolacja kulki, platformy stoją
+            out = frames.back();
+            float ahead = std::min((float)((render_tick - out.tick) * tick_dt), MAX_EXTRAPOLATION);
+            out.ball_x += out.ball_vx * ahead;
+            out.ball_y += out.ball_vy * ahead;
+            return true;
+        }
+        
+        size_t next = 1;
+        while (frames[next].tick < render_tick) next++;
+        const Frame& a = frames[next - 1];
+        const Frame& b = frames[next];
+        float t = (float)((render_tick - a.tick) / (b.tick - a.tick));
+        
+        out = a;
+        out.tick = (int64_t)render_tick;
+        if (std::fabs(b.ball_x - a.ball_x) < TELEPORT_DISTANCE &&
+            std::fabs(b.ball_y - a.ball_y) < TELEPORT_DISTANCE) {
+            out.ball_x = a.ball_x + (b.ball_x - a.ball_x) * t;
+            out.ball_y = a.ball_y + (b.ball_y - a.ball_y) * t;
+        } else if (t >= 0.5f) {
+            out.ball_x = b.ball_x;
+            out.ball_y = b.ball_y;
+        }
+        for (int i = 0; i < 4; i++) {
+            out.paddles[i] = a.paddles[i] + (b.paddles[i] - a.paddles[i]) * t;
+        }
+        return true;
+    }
+    
+private:
+    std::deque<Frame> frames;
+    float tick_dt;
+    float delay;
+    bool has_offset;
+    double offset;  // sekundy: czas lokalny - czas serwera
+    clock::time_point origin;
+    
+    double seconds(clock::time_point t) const {
+        return std::chrono::duration<double>(t - origin).count();
+    }
+    
+    int64_t unwrap(uint16_t tick16) const {
+        if (frames.empty()) return tick16;
+        int64_t last = frames.back().tick;
+        return last + (int16_t)(tick16 - (uint16_t)last);
+    }
+};
\ No newline at end of file
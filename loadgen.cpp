@@ -0,0 +1,616 @@
+#include "common.h"
+#include "snapshot.h"
+#include "metrics.h"
+#include "framing.h"
+#include "wire.h"
+#include <iostream>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <array>
+#include <random>
+#include <algorithm>
+
+// Generator obciążenia: N botów w jednym procesie, bez ncurses i wątków.
+// Każdy bot przechodzi tę samą ścieżkę co klient (pokój, lobby, UDP_BIND,
+// gotowość), a w grze wysyła akcje z zadaną częstotliwością i potwierdza
+// migawki. Mierzone są: czas dołączenia, odstępy i jitter migawek oraz RTT
+// wejścia (wysłanie akcji -> pierwsza migawka, w której serwer ją potwierdza).
+
+using Clock = std::chrono::steady_clock;
+
+const int LOADGEN_TICK_MS = 10;             // rozdzielczość harmonogramu botów
+const int CONNECT_BATCH = 50;               // nowe połączenia na takt (bez zalewania kolejki accept)
+const int BOTS_PER_ROOM = 4;
+const int BIND_RETRY_MS = 200;
+const int SENT_HISTORY = 64;                // czasy wysłania ostatnich wejść (pomiar RTT)
+const int MAX_LOADGEN_EVENTS = 512;
+const size_t LOADGEN_RECV_BUFFER = 512;
+
+enum BotStage {
+    BOT_WAITING,      // jeszcze nie połączony (narastanie obciążenia)
+    BOT_CONNECTING,   // trwa nieblokujący connect
+    BOT_SELECT_ROOM,  // wysłano CREATE_JOIN_SERVER
+    BOT_JOIN_LOBBY,   // wysłano JOIN_LOBBY
+    BOT_BINDING,      // oczekiwanie na UDP_BIND_ACK
+    BOT_READY,        // gotowy, oczekiwanie na GAME_START
+    BOT_PLAYING,
+    BOT_FAILED
+};
+
+enum ActionMode {
+    MODE_RANDOM,  // losowa akcja w każdym kroku
+    MODE_SCRIPT   // stały wzorzec: lewo, stop, prawo, stop
+};
+
+struct Bot {
+    int id;
+    int tcp_socket;
+    int udp_socket;
+    BotStage stage;
+    FrameReader tcp_in;
+    FrameWriter tcp_out;
+    int player_id;
+    uint64_t session_token;
+    Clock::time_point connect_start;
+    Clock::time_point last_bind;
+    Clock::time_point next_action;
+    Clock::time_point last_sync;
+    bool has_sync;
+    uint32_t input_seq;                          // numer ostatnio wysłanego wejścia
+    std::array<int32_t, SENT_HISTORY> actions;   // wejścia wg numeru (redundancja)
+    std::array<Clock::time_point, SENT_HISTORY> sent_at;
+    uint16_t measured_input;                     // ostatnie wejście, dla którego zmierzono RTT
+    SnapshotHistory snapshots;
+    std::mt19937 rng;
+    
+    explicit Bot(int bot_id) : id(bot_id), tcp_socket(-1), udp_socket(-1), stage(BOT_WAITING), tcp_in(1024), tcp_out(1024),
+                               player_id(-1), session_token(0), has_sync(false), input_seq(0),
+                               actions{}, measured_input(0), rng(bot_id * 7919 + 1) {}
+};
+
+struct LoadStats {
+    uint64_t joined = 0;
+    uint64_t rejected = 0;        // pokój pełny / gra trwa (SERVER_RESPONSE -1)
+    uint64_t failed = 0;          // błąd połączenia lub protokołu
+    uint64_t games_started = 0;
+    uint64_t actions_sent = 0;
+    uint64_t datagrams_sent = 0;
+    uint64_t datagrams_received = 0;
+    uint64_t bytes_received = 0;
+    uint64_t syncs = 0;
+    uint64_t undecodable = 0;
+    uint64_t propagations = 0;
+    LatencyHistogram join_time;      // connect -> PLAYER_JOINED
+    LatencyHistogram sync_interval;  // odstęp między kolejnymi migawkami bota
+    LatencyHistogram sync_jitter;    // |odstęp - 1/SYNC_RATE|
+    LatencyHistogram input_rtt;      // akcja -> migawka z jej potwierdzeniem
+};
+
+class LoadGenerator {
+public:
+    LoadGenerator(const std::string& ip, int port, int bot_count, int actions_per_second, ActionMode mode)
+        : server_ip(ip), port(port), actions_per_second(actions_per_second), mode(mode),
+          epoll_fd(-1), timer_fd(-1), connected_bots(0) {
+        for (int i = 0; i < bot_count; i++) {
+            bots.emplace_back(i);
+        }
+    }
+    
+    ~LoadGenerator() {
+        for (Bot& bot : bots) {
+            close_bot(bot);
+        }
+        if (timer_fd >= 0) close(timer_fd);
+        if (epoll_fd >= 0) close(epoll_fd);
+    }
+    
+    bool start() {
+        server_addr = sockaddr_in{};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, server_ip.c_str(), &server_addr.sin_addr) <= 0) {
+            std::cerr << "Nieprawidłowy adres IP: " << server_ip << "\n";
+            return false;
+        }
+        
+        epoll_fd = epoll_create1(0);
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (epoll_fd < 0 || timer_fd < 0) {
+            std::cerr << "Błąd tworzenia epoll/timerfd\n";
+            return false;
+        }
+        
+        itimerspec spec{};
+        spec.it_interval.tv_nsec = LOADGEN_TICK_MS * 1000000L;
+        spec.it_value = spec.it_interval;
+        timerfd_settime(timer_fd, 0, &spec, nullptr);
+        
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = UINT64_MAX;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+        return true;
+    }
+    
+    void run(int duration_seconds) {
+        start_time = Clock::now();
+        auto end_time = start_time + std::chrono::seconds(duration_seconds);
+        auto next_report = start_time + std::chrono::seconds(1);
+        epoll_event events[MAX_LOADGEN_EVENTS];
+        
+        while (Clock::now() < end_time) {
+            int count = epoll_wait(epoll_fd, events, MAX_LOADGEN_EVENTS, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Błąd epoll_wait: " << strerror(errno) << "\n";
+                break;
+            }
+            
+            for (int i = 0; i < count; i++) {
+                uint64_t key = events[i].data.u64;
+                if (key == UINT64_MAX) {
+                    uint64_t expirations;
+                    if (read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+                        on_tick();
+                    }
+                    continue;
+                }
+                
+                // Klucz: numer bota * 2 + (1 dla gniazda UDP)
+                Bot& bot = bots[key >> 1];
+                if (key & 1) {
+                    handle_udp(bot);
+                } else {
+                    handle_tcp(bot, events[i].events);
+                }
+            }
+            
+            if (Clock::now() >= next_report) {
+                report_progress();
+                next_report += std::chrono::seconds(1);
+            }
+        }
+        
+        elapsed = std::chrono::duration<double>(Clock::now() - start_time).count();
+        
+        // Kulturalne wyjście - serwer zwalnia pokoje od razu
+        for (Bot& bot : bots) {
+            if (bot.tcp_socket >= 0 && bot.stage >= BOT_BINDING && bot.stage != BOT_FAILED) {
+                bot.tcp_out.queue(PACKET_PLAYER_LEAVE, nullptr, 0);
+                bot.tcp_out.flush(bot.tcp_socket);
+            }
+            close_bot(bot);
+        }
+    }
+    
+    void print_report() const {
+        printf("\n=== Wynik testu obciążenia ===\n");
+        printf("Boty: %zu (dołączyło %llu, odrzuconych %llu, błędów %llu), rozpoczętych gier: %llu\n",
+               bots.size(), (unsigned long long)stats.joined, (unsigned long long)stats.rejected,
+               (unsigned long long)stats.failed, (unsigned long long)stats.games_started);
+        printf("Czas testu: %.1f s\n", elapsed);
+        printf("Wysłane datagramy: %llu (%.0f/s), w tym akcji: %llu\n",
+               (unsigned long long)stats.datagrams_sent, stats.datagrams_sent / elapsed,
+               (unsigned long long)stats.actions_sent);
+        printf("Odebrane datagramy: %llu (%.0f/s, %.1f kB/s)\n",
+               (unsigned long long)stats.datagrams_received, stats.datagrams_received / elapsed,
+               stats.bytes_received / elapsed / 1024.0);
+        printf("Migawki: %llu, nieudekodowane: %llu, propagacje akcji: %llu\n",
+               (unsigned long long)stats.syncs, (unsigned long long)stats.undecodable,
+               (unsigned long long)stats.propagations);
+        
+        printf("\n%-26s %9s %9s %9s %9s %9s %9s\n", "Opóźnienia [ms]", "próbek", "p50", "p90", "p99", "p99.9", "max");
+        print_histogram("dołączenie", stats.join_time);
+        print_histogram("odstęp migawek", stats.sync_interval);
+        print_histogram("jitter migawek", stats.sync_jitter);
+        print_histogram("RTT wejścia", stats.input_rtt);
+    }
+    
+private:
+    std::string server_ip;
+    int port;
+    int actions_per_second;
+    ActionMode mode;
+    sockaddr_in server_addr;
+    int epoll_fd;
+    int timer_fd;
+    std::vector<Bot> bots;
+    int connected_bots;  // boty, którym rozpoczęto connect
+    LoadStats stats;
+    Clock::time_point start_time;
+    double elapsed = 0.0;
+    uint64_t reported_syncs = 0;    // stan liczników przy poprzednim raporcie
+    uint64_t reported_actions = 0;
+    
+    static void print_histogram(const char* name, const LatencyHistogram& histogram) {
+        // printf liczy bajty, nie znaki - wyrównanie polskich nazw ręcznie
+        int padding = 26 - (int)std::count_if(name, name + strlen(name), [](char c) { return (c & 0xC0) != 0x80; });
+        printf("%s%*s %9llu %9.2f %9.2f %9.2f %9.2f %9.2f\n", name, std::max(0, padding), "",
+               (unsigned long long)histogram.count(), histogram.quantile(0.5) * 1e-6,
+               histogram.quantile(0.9) * 1e-6, histogram.quantile(0.99) * 1e-6,
+               histogram.quantile(0.999) * 1e-6, histogram.max_nanos() * 1e-6);
+    }
+    
+    void report_progress() {
+        int playing = 0;
+        for (const Bot& bot : bots) {
+            if (bot.stage == BOT_PLAYING) playing++;
+        }
+        int seconds = (int)std::chrono::duration<double>(Clock::now() - start_time).count();
+        printf("[%3d s] w grze: %d/%zu, migawki/s: %llu, akcje/s: %llu, RTT wejścia p99: %.1f ms\n",
+               seconds, playing, bots.size(), (unsigned long long)(stats.syncs - reported_syncs),
+               (unsigned long long)(stats.actions_sent - reported_actions), stats.input_rtt.quantile(0.99) * 1e-6);
+        fflush(stdout);
+        reported_syncs = stats.syncs;
+        reported_actions = stats.actions_sent;
+    }
+    
+    void on_tick() {
+        auto now = Clock::now();
+        
+        // Narastanie: co takt kolejna porcja połączeń
+        for (int i = 0; i < CONNECT_BATCH && connected_bots < (int)bots.size(); i++) {
+            connect_bot(bots[connected_bots++], now);
+        }
+        
+        for (Bot& bot : bots) {
+            if (bot.stage == BOT_BINDING && now - bot.last_bind >= std::chrono::milliseconds(BIND_RETRY_MS)) {
+                send_bind(bot, now);
+            } else if (bot.stage == BOT_PLAYING && actions_per_second > 0 && now >= bot.next_action) {
+                send_action(bot, now);
+            }
+        }
+    }
+    
+    void watch(int fd, uint64_t key, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = key;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+    
+    void connect_bot(Bot& bot, Clock::time_point now) {
+        bot.connect_start = now;
+        bot.tcp_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        bot.udp_socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (bot.tcp_socket < 0 || bot.udp_socket < 0) {
+            fail_bot(bot, "socket");
+            return;
+        }
+        
+        int opt = 1;
+        setsockopt(bot.tcp_socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        
+        // Połączony socket UDP - send/recv bez adresu, odbiera tylko od serwera
+        if (connect(bot.udp_socket, (sockaddr*)&server_addr, sizeof(server_addr)) < 0 ||
+            (connect(bot.tcp_socket, (sockaddr*)&server_addr, sizeof(server_addr)) < 0 && errno != EINPROGRESS)) {
+            fail_bot(bot, "connect");
+            return;
+        }
+        
+        bot.stage = BOT_CONNECTING;
+        watch(bot.tcp_socket, (uint64_t)bot.id << 1, EPOLLIN | EPOLLOUT);
+        watch(bot.udp_socket, ((uint64_t)bot.id << 1) | 1, EPOLLIN);
+    }
+    
+    void close_bot(Bot& bot) {
+        if (bot.tcp_socket >= 0) close(bot.tcp_socket);
+        if (bot.udp_socket >= 0) close(bot.udp_socket);
+        bot.tcp_socket = bot.udp_socket = -1;
+    }
+    
+    void fail_bot(Bot& bot, const char* reason) {
+        if (stats.failed++ < 10) {
+            std::cerr << "Bot " << bot.id << ": " << reason << " (" << strerror(errno) << ")\n";
+        }
+        bot.stage = BOT_FAILED;
+        close_bot(bot);
+    }
+    
+    void send_tcp(Bot& bot, uint8_t packet_type, const void* payload, size_t length) {
+        if (bot.tcp_socket < 0) return;
+        // Komunikaty są małe, a bufor gniazda pusty - ramka wychodzi w całości od razu
+        bot.tcp_out.queue(packet_type, payload, length);
+        if (bot.tcp_out.flush(bot.tcp_socket) != FRAME_IO_OK) {
+            fail_bot(bot, "send");
+        }
+    }
+    
+    template <typename P>
+    void send_packet(Bot& bot, const P& packet) {
+        uint8_t buffer[WIRE_MAX_SIZE<P>];
+        send_tcp(bot, WireSchema<P>::type, buffer, wire_encode(packet, buffer));
+    }
+    
+    void handle_tcp(Bot& bot, uint32_t events) {
+        if (bot.stage == BOT_FAILED || bot.tcp_socket < 0) return;
+        
+        if (bot.stage == BOT_CONNECTING) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(bot.tcp_socket, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+                errno = error;
+                fail_bot(bot, "connect");
+                return;
+            }
+            
+            // Połączono - dalej tylko odczyt
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = (uint64_t)bot.id << 1;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, bot.tcp_socket, &event);
+            
+            CreateJoinServerPacket create_packet{};
+            std::string room_name = "loadgen-" + std::to_string(bot.id / BOTS_PER_ROOM);
+            create_packet.server_name_length = room_name.size();
+            memcpy(create_packet.server_name, room_name.data(), room_name.size());
+            bot.stage = BOT_SELECT_ROOM;
+            // Wybór pokoju zaraz za HELLO, bez czekania na HELLO_ACK - przy niezgodnej
+            // wersji serwer i tak zamknie połączenie przed jego przetworzeniem
+            send_packet(bot, HelloPacket{PROTOCOL_VERSION, PROTOCOL_MIN_VERSION});
+            send_packet(bot, create_packet);
+            return;
+        }
+        
+        while (true) {
+            errno = 0;
+            FrameIo result = bot.tcp_in.fill(bot.tcp_socket);
+            if (result == FRAME_IO_CLOSED) {
+                if (errno == 0) errno = ECONNRESET;  // koniec strumienia
+                fail_bot(bot, "serwer zamknął połączenie");
+                return;
+            }
+            process_tcp_messages(bot);
+            if (result == FRAME_IO_AGAIN || bot.stage == BOT_FAILED) return;
+        }
+    }
+    
+    void process_tcp_messages(Bot& bot) {
+        Frame frame;
+        while (bot.stage != BOT_FAILED && bot.tcp_in.next(frame)) {
+            if (!handle_tcp_message(bot, frame)) {
+                errno = EPROTO;
+                fail_bot(bot, "nieznany lub uszkodzony komunikat TCP");
+                return;
+            }
+        }
+        if (bot.stage != BOT_FAILED && bot.tcp_in.is_broken()) {
+            errno = EPROTO;
+            fail_bot(bot, "niepoprawna ramka TCP");
+        }
+    }
+    
+    // false, gdy komunikatu nie da się zdekodować
+    bool handle_tcp_message(Bot& bot, const Frame& frame) {
+        auto now = Clock::now();
+        
+        switch (frame.type) {
+            case PACKET_HELLO_ACK: {
+                HelloAckPacket response;
+                if (!wire_decode(frame.payload, frame.length, response)) return false;
+                if (response.version == 0) {
+                    errno = EPROTONOSUPPORT;
+                    fail_bot(bot, "niezgodna wersja protokołu");
+                }
+                break;
+            }
+            case PACKET_SERVER_RESPONSE: {
+                ServerResponsePacket response;
+                if (!wire_decode(frame.payload, frame.length, response)) return false;
+                if (response.port == -1) {
+                    stats.rejected++;
+                    bot.stage = BOT_FAILED;
+                    close_bot(bot);
+                    return true;
+                }
+                
+                JoinLobbyPacket join_packet{};
+                std::string nick = "bot" + std::to_string(bot.id);
+                join_packet.nick_length = nick.size();
+                strncpy(join_packet.nick, nick.c_str(), sizeof(join_packet.nick) - 1);
+                bot.stage = BOT_JOIN_LOBBY;
+                send_packet(bot, join_packet);
+                break;
+            }
+            case PACKET_PLAYER_JOINED: {
+                PlayerJoinedPacket joined;
+                if (!wire_decode(frame.payload, frame.length, joined)) return false;
+                bot.player_id = joined.player_id;
+                bot.session_token = joined.session_token;
+                stats.joined++;
+                stats.join_time.record(now - bot.connect_start);
+                
+                bot.stage = BOT_BINDING;
+                send_bind(bot, now);
+                break;
+            }
+            case PACKET_GAME_START:
+                stats.games_started++;
+                bot.stage = BOT_PLAYING;
+                bot.has_sync = false;
+                // Rozłożenie akcji botów w czasie zamiast jednej fali na takt
+                if (actions_per_second > 0) {
+                    bot.next_action = now + std::chrono::microseconds(bot.rng() % (1000000 / actions_per_second));
+                }
+                break;
+            case PACKET_READY_PROPAGATION:
+            case PACKET_GAME_END:
+            case PACKET_PLAYER_LEFT:
+                break;  // gotowość innych graczy, wyjścia - bez znaczenia dla pomiarów
+            default:
+                return false;
+        }
+        return true;
+    }
+    
+    void send_udp(Bot& bot, const void* data, size_t length) {
+        if (send(bot.udp_socket, data, length, MSG_DONTWAIT) == (ssize_t)length) {
+            stats.datagrams_sent++;
+        }
+    }
+    
+    void send_bind(Bot& bot, Clock::time_point now) {
+        uint8_t buffer[1 + WIRE_MAX_SIZE<UdpBindPacket>];
+        send_udp(bot, buffer, wire_encode_datagram(UdpBindPacket{bot.session_token}, buffer));
+        bot.last_bind = now;
+    }
+    
+    int32_t next_action(Bot& bot) {
+        if (mode == MODE_SCRIPT) {
+            static const int32_t script[] = {ACTION_MOVE_LEFT, ACTION_STOP, ACTION_MOVE_RIGHT, ACTION_STOP};
+            return script[bot.input_seq % 4];
+        }
+        return (int32_t)(bot.rng() % 3);
+    }
+    
+    void send_action(Bot& bot, Clock::time_point now) {
+        uint32_t seq = ++bot.input_seq;
+        bot.actions[seq % SENT_HISTORY] = next_action(bot);
+        bot.sent_at[seq % SENT_HISTORY] = now;
+        
+        PlayerActionPacket packet{};
+        packet.session_token = bot.session_token;
+        packet.input_seq = seq;
+        packet.count = std::min<uint32_t>(INPUT_REDUNDANCY, seq);
+        for (int i = 0; i < INPUT_REDUNDANCY; i++) {
+            packet.actions[i] = i < packet.count ? bot.actions[(seq - i) % SENT_HISTORY] : ACTION_STOP;
+        }
+        uint8_t buffer[1 + WIRE_MAX_SIZE<PlayerActionPacket>];
+        send_udp(bot, buffer, wire_encode_datagram(packet, buffer));
+        stats.actions_sent++;
+        
+        bot.next_action += std::chrono::microseconds(1000000 / actions_per_second);
+        if (bot.next_action < now) bot.next_action = now;  // po przeciążeniu nie nadrabiamy serii
+    }
+    
+    void handle_udp(Bot& bot) {
+        uint8_t buffer[LOADGEN_RECV_BUFFER];
+        while (bot.udp_socket >= 0) {
+            int bytes = recv(bot.udp_socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (bytes <= 0) return;
+            
+            stats.datagrams_received++;
+            stats.bytes_received += bytes;
+            auto now = Clock::now();
+            
+            switch (buffer[0]) {
+                case PACKET_UDP_BIND_ACK:
+                    if (bot.stage == BOT_BINDING) {
+                        bot.stage = BOT_READY;
+                        send_tcp(bot, PACKET_PLAYER_READY, nullptr, 0);
+                    }
+                    break;
+                case PACKET_GAME_SYNC:
+                    handle_sync(bot, buffer + 1, bytes - 1, now);
+                    break;
+                case PACKET_ACTION_PROPAGATION:
+                    stats.propagations++;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    
+    void handle_sync(Bot& bot, const uint8_t* data, size_t length, Clock::time_point now) {
+        Snapshot snapshot;
+        SnapshotInput input;
+        if (!decode_snapshot(data, length, bot.snapshots, snapshot, input)) {
+            stats.undecodable++;
+            return;
+        }
+        bot.snapshots.put(snapshot);
+        stats.syncs++;
+        
+        SnapshotAckPacket packet{};
+        packet.session_token = bot.session_token;
+        packet.snapshot_seq = snapshot.seq;
+        uint8_t ack[1 + WIRE_MAX_SIZE<SnapshotAckPacket>];
+        send_udp(bot, ack, wire_encode_datagram(packet, ack));
+        
+        if (bot.has_sync) {
+            auto interval = now - bot.last_sync;
+            stats.sync_interval.record(interval);
+            auto expected = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / SYNC_RATE));
+            stats.sync_jitter.record(interval > expected ? interval - expected : expected - interval);
+        }
+        bot.last_sync = now;
+        bot.has_sync = true;
+        
+        // Pierwsza migawka potwierdzająca nowe wejście zamyka pomiar RTT
+        // (numer w migawce to młodsze 16 bitów; starsze wejścia mają już pomiar)
+        uint16_t acked = input.input_seq;
+        if (acked != 0 && seq_newer(acked, bot.measured_input)) {
+            uint16_t behind = (uint16_t)bot.input_seq - acked;
+            if (behind < SENT_HISTORY && bot.input_seq >= behind) {
+                uint32_t seq = bot.input_seq - behind;
+                stats.input_rtt.record(now - bot.sent_at[seq % SENT_HISTORY]);
+            }
+            bot.measured_input = acked;
+        }
+    }
+};
+
+// Podnosi limit deskryptorów - każdy bot ma dwa gniazda
+static void raise_fd_limit(size_t needed) {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < needed) {
+        limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, needed);
+        setrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur < needed) {
+            std::cerr << "Uwaga: limit deskryptorów " << limit.rlim_cur << " - część botów się nie połączy\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string server_ip = "127.0.0.1";
+    int port = 8080;
+    int bot_count = 100;
+    int duration = 30;
+    int actions_per_second = 5;
+    ActionMode mode = MODE_RANDOM;
+    
+    if (argc > 1) server_ip = argv[1];
+    if (argc > 2) port = std::atoi(argv[2]);
+    if (argc > 3) bot_count = std::max(1, std::atoi(argv[3]));
+    if (argc > 4) duration = std::max(1, std::atoi(argv[4]));
+    if (argc > 5) actions_per_second = std::max(0, std::min(1000, std::atoi(argv[5])));
+    if (argc > 6) {
+        std::string name = argv[6];
+        if (name == "skrypt") {
+            mode = MODE_SCRIPT;
+        } else if (name != "losowo") {
+            std::cerr << "Nieznany tryb akcji: " << name << " (losowo|skrypt)\n";
+            return 1;
+        }
+    }
+    
+    raise_fd_limit(bot_count * 2 + 64);
+    
+    std::cout << "Generator obciążenia: " << bot_count << " botów -> " << server_ip << ":" << port
+              << ", " << duration << " s, " << actions_per_second << " akcji/s na bota ("
+              << (mode == MODE_SCRIPT ? "skrypt" : "losowo") << ")\n";
+    
+    LoadGenerator generator(server_ip, port, bot_count, actions_per_second, mode);
+    if (!generator.start()) {
+        return 1;
+    }
+    
+    generator.run(duration);
+    generator.print_report();
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+// Asynchroniczny logger wspólny dla serwera i klienta.
+//
+// LOG_INFO("Gracz " << id << " dołączył") formatuje komunikat w wątku
+// wywołującym, wstawia go do ograniczonej kolejki bez blokad (MPSC, wiele
+// wątków piszących, jeden czytający) i natychmiast wraca. Wątek zapisujący
+// dopisuje znacznik czasu i zapisuje wsadami do buforowanego pliku.
+// Gdy kolejka jest pełna, komunikat jest odrzucany (i liczony) - logowanie
+// nigdy nie blokuje pętli gry. Poziomy poniżej LOG_MIN_LEVEL (ustawianego przy
+// kompilacji, np. -DLOG_MIN_LEVEL=0) znikają z kodu całkowicie.
+
+enum LogLevel {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_WARN = 2,
+    LOG_LEVEL_ERROR = 3
+};
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 1  // domyślnie bez komunikatów DEBUG
+#endif
+
+const size_t LOG_QUEUE_CAPACITY = 4096;   // potęga dwójki
+const size_t LOG_MESSAGE_SIZE = 240;      // dłuższe komunikaty są obcinane
+const size_t LOG_FILE_BUFFER = 1 << 16;
+
+class Logger {
+public:
+    static Logger& instance() {
+        static Logger logger;
+        return logger;
+    }
+    
+    // Uruchamia wątek zapisujący; path == nullptr - standardowe wyjście
+    bool start(const char* path) {
+        if (running.load()) return true;
+        file = path ? fopen(path, "a") : stdout;
+        if (!file) return false;
+        setvbuf(file, file_buffer, _IOFBF, sizeof(file_buffer));
+        running.store(true);
+        writer = std::thread(&Logger::run, this);
+        return true;
+    }
+    
+    // Zapisuje wszystko, co zostało w kolejce, i zatrzymuje wątek
+    void stop() {
+        if (!running.exchange(false)) return;
+        writer.join();
+        if (file != stdout) fclose(file);
+        file = nullptr;
+    }
+    
+    // Wstawia komunikat do kolejki bez blokad (bezpieczne z wielu wątków)
+    void write(LogLevel level, const char* text, size_t length) {
+        if (!running.load(std::memory_order_relaxed)) {
+            // Logger nie uruchomiony (np. przed startem) - zapis bezpośredni
+            fprintf(stderr, "%.*s\n", (int)length, text);
+            return;
+        }
+        
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & (LOG_QUEUE_CAPACITY - 1)];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);  // kolejka pełna
+                return;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        
+        slot->level = level;
+        slot->time = std::chrono::system_clock::now();
+        slot->length = std::min(length, LOG_MESSAGE_SIZE);
+        memcpy(slot->text, text, slot->length);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+    }
+    
+    uint64_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+    
+    ~Logger() { stop(); }
+    
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        LogLevel level;
+        std::chrono::system_clock::time_point time;
+        size_t length;
+        char text[LOG_MESSAGE_SIZE];
+    };
+    
+    Slot slots[LOG_QUEUE_CAPACITY];
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) size_t dequeue_pos;  // tylko wątek zapisujący
+    std::atomic<uint64_t> dropped;
+    uint64_t reported_dropped;
+    std::atomic<bool> running;
+    std::thread writer;
+    FILE* file;
+    char file_buffer[LOG_FILE_BUFFER];
+    
+    Logger() : enqueue_pos(0), dequeue_pos(0), dropped(0), reported_dropped(0), running(false), file(nullptr) {
+        for (size_t i = 0; i < LOG_QUEUE_CAPACITY; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    void run() {
+        while (running.load()) {
+            if (!drain()) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        drain();
+    }
+    
+    // Zapisuje wszystkie gotowe komunikaty; false gdy kolejka była pusta
+    bool drain() {
+        static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+        bool written = false;
+        
+        for (;;) {
+            Slot& slot = slots[dequeue_pos & (LOG_QUEUE_CAPACITY - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) break;
+            
+            time_t seconds = std::chrono::system_clock::to_time_t(slot.time);
+            int millis = std::chrono::duration_cast<std::chrono::milliseconds>(
+                slot.time.time_since_epoch()).count() % 1000;
+            tm local;
+            localtime_r(&seconds, &local);
+            fprintf(file, "%02d:%02d:%02d.%03d [%s] %.*s\n", local.tm_hour, local.tm_min, local.tm_sec,
+                    millis, names[slot.level], (int)slot.length, slot.text);
+            
+            slot.sequence.store(dequeue_pos + LOG_QUEUE_CAPACITY, std::memory_order_release);
+            dequeue_pos++;
+            written = true;
+        }
+        
+        uint64_t now_dropped = dropped.load(std::memory_order_relaxed);
+        if (now_dropped != reported_dropped) {
+            fprintf(file, "[WARN] Pełna kolejka logów - odrzucono %llu komunikatów\n",
+                    (unsigned long long)(now_dropped - reported_dropped));
+            reported_dropped = now_dropped;
+            written = true;
+        }
+        
+        if (written) fflush(file);
+        return written;
+    }
+};
+
+// Strumień do formatowania komunikatu, wielokrotnego użytku w danym wątku
+inline std::ostringstream& log_stream() {
+    thread_local std::ostringstream stream;
+    stream.str(std::string());
+    stream.clear();
+    return stream;
+}
+
+#define LOG_AT(level, expr) \
+    do { \
+        if ((level) >= LOG_MIN_LEVEL) { \
+            std::ostringstream& log_stream_ = log_stream(); \
+            log_stream_ << expr; \
+            const std::string& log_text_ = log_stream_.str(); \
+            Logger::instance().write((level), log_text_.data(), log_text_.size()); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(expr) LOG_AT(LOG_LEVEL_DEBUG, expr)
+#define LOG_INFO(expr) LOG_AT(LOG_LEVEL_INFO, expr)
+#define LOG_WARN(expr) LOG_AT(LOG_LEVEL_WARN, expr)
+#define LOG_ERROR(expr) LOG_AT(LOG_LEVEL_ERROR, expr)
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Metryki gorącej ścieżki: liczniki i histogramy opóźnień bez blokad.
+// Zapis to jedna (lub kilka) operacji atomowych relaxed, więc można je
+// aktualizować z dowolnego wątku bez wpływu na takt gry; odczyt (eksport
+// w formacie tekstowym Prometheusa) odbywa się rzadko, na żądanie.
+
+class Counter {
+public:
+    Counter() : value(0) {}
+    
+    void add(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+    
+private:
+    std::atomic<uint64_t> value;
+};
+
+// Histogram w stylu HDR: kubełki log-liniowe - każda potęga dwójki dzielona
+// na HISTOGRAM_SUB_BUCKETS/2 równych części, więc błąd względny kwantyli
+// nie przekracza ~6%, a zakres (1 ns - ~68 s) mieści się w stałej tablicy.
+const int HISTOGRAM_SUB_BITS = 5;
+const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;        // 32
+const int HISTOGRAM_HALF_BUCKETS = HISTOGRAM_SUB_BUCKETS / 2;     // 16
+const int HISTOGRAM_MAX_BIT = 36;                                 // 2^36 ns ~ 68 s
+const int HISTOGRAM_BUCKETS = HISTOGRAM_SUB_BUCKETS +
+    (HISTOGRAM_MAX_BIT - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_HALF_BUCKETS;
+
+class LatencyHistogram {
+public:
+    LatencyHistogram() : total(0), sum(0), max_value(0) {
+        for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+    }
+    
+    // Zapisuje jedną próbkę w nanosekundach
+    void record(uint64_t nanos) {
+        buckets[bucket_index(nanos)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(nanos, std::memory_order_relaxed);
+        
+        uint64_t current = max_value.load(std::memory_order_relaxed);
+        while (nanos > current &&
+               !max_value.compare_exchange_weak(current, nanos, std::memory_order_relaxed)) {}
+    }
+    
+    template <typename Duration>
+    void record(Duration duration) {
+        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        record((uint64_t)(nanos > 0 ? nanos : 0));
+    }
+    
+    // Dolicza próbki innego histogramu (np. suma z wątków roboczych do eksportu)
+    void add(const LatencyHistogram& other) {
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            buckets[i].fetch_add(other.buckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        total.fetch_add(other.count(), std::memory_order_relaxed);
+        sum.fetch_add(other.sum_nanos(), std::memory_order_relaxed);
+        
+        uint64_t other_max = other.max_nanos();
+        uint64_t current = max_value.load(std::memory_order_relaxed);
+        while (other_max > current &&
+               !max_value.compare_exchange_weak(current, other_max, std::memory_order_relaxed)) {}
+    }
+    
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t sum_nanos() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t max_nanos() const { return max_value.load(std::memory_order_relaxed); }
+    
+    // Kwantyl q (0-1) w nanosekundach - górna granica kubełka, w którym wypada
+    uint64_t quantile(double q) const {
+        uint64_t counts[HISTOGRAM_BUCKETS];
+        uint64_t all = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            counts[i] = buckets[i].load(std::memory_order_relaxed);
+            all += counts[i];
+        }
+        if (all == 0) return 0;
+        
+        uint64_t rank = (uint64_t)(q * all + 0.5);
+        if (rank < 1) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucket_upper(i), max_nanos());
+        }
+        return max_nanos();
+    }
+    
+private:
+    std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max_value;
+    
+    static int bucket_index(uint64_t value) {
+        if (value < (uint64_t)HISTOGRAM_SUB_BUCKETS) return (int)value;
+        int top_bit = 63 - __builtin_clzll(value);
+        if (top_bit > HISTOGRAM_MAX_BIT) return HISTOGRAM_BUCKETS - 1;
+        int shift = top_bit - (HISTOGRAM_SUB_BITS - 1);
+        int sub = (int)(value >> shift) - HISTOGRAM_HALF_BUCKETS;
+        return HISTOGRAM_SUB_BUCKETS + (shift - 1) * HISTOGRAM_HALF_BUCKETS + sub;
+    }
+    
+    static uint64_t bucket_upper(int index) {
+        if (index < HISTOGRAM_SUB_BUCKETS) return (uint64_t)index;
+        int k = index - HISTOGRAM_SUB_BUCKETS;
+        int shift = k / HISTOGRAM_HALF_BUCKETS + 1;
+        uint64_t sub = (uint64_t)(k % HISTOGRAM_HALF_BUCKETS + HISTOGRAM_HALF_BUCKETS);
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+// Składanie odpowiedzi w formacie tekstowym Prometheusa (wersja 0.0.4)
+class MetricsText {
+public:
+    void counter(const char* name, const char* help, uint64_t value) {
+        header(name, help, "counter");
+        line("%s %llu\n", name, (unsigned long long)value);
+    }
+    
+    void gauge(const char* name, const char* help, double value) {
+        header(name, help, "gauge");
+        line("%s %.9g\n", name, value);
+    }
+    
+    // Nagłówek i kolejne próbki miary z etykietami, np. {room="0",player="1"}
+    void gauge_header(const char* name, const char* help) {
+        header(name, help, "gauge");
+    }
+    
+    void gauge_sample(const char* name, const char* labels, double value) {
+        line("%s{%s} %.9g\n", name, labels, value);
+    }
+    
+    // Histogram eksportowany jako summary (kwantyle w sekundach) + osobne maksimum
+    void summary(const char* name, const char* help, const LatencyHistogram& histogram) {
+        static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        
+        header(name, help, "summary");
+        for (double q : quantiles) {
+            line("%s{quantile=\"%g\"} %.9g\n", name, q, histogram.quantile(q) * 1e-9);
+        }
+        line("%s_sum %.9g\n", name, histogram.sum_nanos() * 1e-9);
+        line("%s_count %llu\n", name, (unsigned long long)histogram.count());
+        
+        std::string max_name = std::string(name) + "_max";
+        header(max_name.c_str(), "Największa zarejestrowana wartość (sekundy)", "gauge");
+        line("%s %.9g\n", max_name.c_str(), histogram.max_nanos() * 1e-9);
+    }
+    
+    const std::string& str() const { return out; }
+    
+private:
+    std::string out;
+    
+    void header(const char* name, const char* help, const char* type) {
+        line("# HELP %s %s\n", name, help);
+        line("# TYPE %s %s\n", name, type);
+    }
+    
+    template <typename... Args>
+    void line(const char* format, Args... args) {
+        char buffer[256];
+        int length = snprintf(buffer, sizeof(buffer), format, args...);
+        if (length > 0) out.append(buffer, std::min((size_t)length, sizeof(buffer) - 1));
+    }
+};
\ No newline at end of file
@@ -0,0 +1,332 @@
+#pragma once
+#include "common.h"
+#include <vector>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define T4P_X86_SIMD 1
+#endif
+
+// Kulka, która w całym takcie pozostaje między liniami platform (z marginesem
+// na zaokrąglenia), nie może w nic uderzyć - wystarczy ją przesunąć
+const float SAFE_MIN = PADDLE_OFFSET + BALL_RADIUS;
+const float SAFE_MAX = ARENA_SIZE - PADDLE_OFFSET - BALL_RADIUS;
+const float SAFE_MARGIN = 1e-3f;
+
+// Zakres pozycji środka platformy
+const float PADDLE_MIN = PADDLE_SIZE / 2;
+const float PADDLE_MAX = ARENA_SIZE - PADDLE_SIZE / 2;
+
+// Świat wielu pokoi w układzie SoA (struktura tablic).
+// Stan kulek i platform wszystkich pokoi leży w ciągłych tablicach float, a jeden
+// krok symulacji przechodzi przez wszystkie pokoje naraz wektorowymi kernelami
+// (AVX2 / SSE, z wersją skalarną). Wynik jest bit w bit taki sam jak GameState::update
+// dla każdego pokoju: ruch platform i kulki to te same operacje float (bez FMA),
+// a pokoje, w których kulka może w tym takcie uderzyć w platformę lub ścianę,
+// są doliczane skalarnym GameState::move_ball.
+class BatchWorld {
+public:
+    enum Kernel {
+        KERNEL_SCALAR,
+        KERNEL_SSE,
+        KERNEL_AVX2
+    };
+    
+    // Szerokość najszerszego kernela - liczba slotów jest do niej zaokrąglana
+    static const int LANES = 8;
+    
+    std::vector<float> ball_x, ball_y;
+    std::vector<float> ball_vx, ball_vy;
+    std::array<std::vector<float>, 4> paddle_pos;
+    std::array<std::vector<float>, 4> paddle_dir;  // -1 w lewo, 0 stop, 1 w prawo
+    std::array<std::vector<int32_t>, 4> scores;
+    std::vector<int32_t> running;  // maska: -1 gra trwa, 0 w przeciwnym razie
+    std::vector<uint64_t> rng_state;  // generator losowy pokoju (GameState::rng_state)
+    
+    explicit BatchWorld(int rooms) : slots((rooms + LANES - 1) / LANES * LANES), kernel(best_kernel()) {
+        ball_x.resize(slots); ball_y.resize(slots);
+        ball_vx.resize(slots); ball_vy.resize(slots);
+        for (int p = 0; p < 4; p++) {
+            paddle_pos[p].resize(slots);
+            paddle_dir[p].resize(slots);
+            scores[p].resize(slots);
+        }
+        running.resize(slots);
+        rng_state.resize(slots);
+        
+        for (int slot = 0; slot < slots; slot++) {
+            reset(slot);
+        }
+    }
+    
+    int size() const { return slots; }
+    
+    Kernel get_kernel() const { return kernel; }
+    
+    // Wybór kernela (np. do porównań w testach wydajności); niedostępny kernel jest ignorowany
+    void set_kernel(Kernel k) {
+        if (k <= best_kernel()) kernel = k;
+    }
+    
+    static Kernel best_kernel() {
+#ifdef T4P_X86_SIMD
+        if (__builtin_cpu_supports("avx2")) return KERNEL_AVX2;
+        return KERNEL_SSE;
+#else
+        return KERNEL_SCALAR;
+#endif
+    }
+    
+    void reset(int slot) {
+        load(slot, GameState());
+    }
+    
+    void start(int slot) {
+        running[slot] = -1;
+    }
+    
+    // Ziarno generatora losowego pokoju - ustawiane przed startem gry
+    void seed(int slot, uint64_t value) {
+        rng_state[slot] = value;
+    }
+    
+    bool is_running(int slot) const {
+        return running[slot] != 0;
+    }
+    
+    void set_action(int slot, int player_id, PlayerAction action) {
+        switch(action) {
+            case ACTION_MOVE_LEFT:  paddle_dir[player_id][slot] = -1.0f; break;
+            case ACTION_MOVE_RIGHT: paddle_dir[player_id][slot] = 1.0f; break;
+            case ACTION_STOP:       paddle_dir[player_id][slot] = 0.0f; break;
+        }
+    }
+    
+    // Zapisuje stan pokoju do slotu
+    void load(int slot, const GameState& state) {
+        ball_x[slot] = state.ball.x;
+        ball_y[slot] = state.ball.y;
+        ball_vx[slot] = state.ball.velocity_x;
+        ball_vy[slot] = state.ball.velocity_y;
+        
+        for (int p = 0; p < 4; p++) {
+            const Paddle& paddle = state.paddles[p];
+            paddle_pos[p][slot] = paddle.position;
+            if (paddle.moving_left && !paddle.moving_right) {
+                paddle_dir[p][slot] = -1.0f;
+            } else if (paddle.moving_right && !paddle.moving_left) {
+                paddle_dir[p][slot] = 1.0f;
+            } else {
+                paddle_dir[p][slot] = 0.0f;
+            }
+            scores[p][slot] = state.scores[p];
+        }
+        
+        running[slot] = state.game_running ? -1 : 0;
+        rng_state[slot] = state.rng_state;
+    }
+    
+    // Odczytuje stan pokoju ze slotu
+    void store(int slot, GameState& state) const {
+        state.ball.x = ball_x[slot];
+        state.ball.y = ball_y[slot];
+        state.ball.velocity_x = ball_vx[slot];
+        state.ball.velocity_y = ball_vy[slot];
+        
+        for (int p = 0; p < 4; p++) {
+            Paddle& paddle = state.paddles[p];
+            paddle.position = paddle_pos[p][slot];
+            paddle.moving_left = paddle_dir[p][slot] < 0;
+            paddle.moving_right = paddle_dir[p][slot] > 0;
+            state.scores[p] = scores[p][slot];
+        }
+        
+        state.game_running = running[slot] != 0;
+        state.rng_state = rng_state[slot];
+    }
+    
+    // Jeden krok symulacji wszystkich pokoi ze slotów [begin, end).
+    // Granice zakresu muszą być wielokrotnością LANES (poza końcem świata).
+    // Rozłączne zakresy można liczyć równolegle w różnych wątkach.
+    void step(float dt, int begin = 0, int end = -1) {
+        if (end < 0 || end > slots) end = slots;
+        
+        switch (kernel) {
+#ifdef T4P_X86_SIMD
+            case KERNEL_AVX2:
+                step_paddles_avx2(dt, begin, end);
+                step_balls_avx2(dt, begin, end);
+                return;
+            case KERNEL_SSE:
+                step_paddles_sse(dt, begin, end);
+                step_balls_sse(dt, begin, end);
+                return;
+#endif
+            default:
+                step_paddles_scalar(dt, begin, end);
+                step_balls_scalar(dt, begin, end);
+                return;
+        }
+    }
+    
+private:
+    int slots;
+    Kernel kernel;
+    
+    // Pełna (skalarna) obsługa ruchu kulki z kolizjami dla jednego slotu. Stan
+    // pomocniczy jest osobny dla każdego wątku, żeby zakresy slotów liczone
+    // równolegle nie dzieliły żadnej pamięci.
+    void resolve_collisions(int slot, float dt) {
+        static thread_local GameState state;
+        store(slot, state);
+        state.move_ball(dt);
+        
+        ball_x[slot] = state.ball.x;
+        ball_y[slot] = state.ball.y;
+        ball_vx[slot] = state.ball.velocity_x;
+        ball_vy[slot] = state.ball.velocity_y;
+        for (int p = 0; p < 4; p++) {
+            scores[p][slot] = state.scores[p];
+        }
+        running[slot] = state.game_running ? -1 : 0;
+        rng_state[slot] = state.rng_state;
+    }
+    
+    void step_paddles_scalar(float dt, int begin, int end) {
+        float step = PADDLE_SPEED * dt;
+        for (int p = 0; p < 4; p++) {
+            float* pos = paddle_pos[p].data();
+            const float* dir = paddle_dir[p].data();
+            for (int i = begin; i < end; i++) {
+                if (!running[i]) continue;
+                float moved = pos[i] + dir[i] * step;
+                if (moved < PADDLE_MIN) moved = PADDLE_MIN;
+                if (moved > PADDLE_MAX) moved = PADDLE_MAX;
+                pos[i] = moved;
+            }
+        }
+    }
+    
+    void step_balls_scalar(float dt, int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            if (!running[i]) continue;
+            float nx = ball_x[i] + ball_vx[i] * dt;
+            float ny = ball_y[i] + ball_vy[i] * dt;
+            bool safe = ball_x[i] >= SAFE_MIN && ball_x[i] <= SAFE_MAX &&
+                        ball_y[i] >= SAFE_MIN && ball_y[i] <= SAFE_MAX &&
+                        nx >= SAFE_MIN + SAFE_MARGIN && nx <= SAFE_MAX - SAFE_MARGIN &&
+                        ny >= SAFE_MIN + SAFE_MARGIN && ny <= SAFE_MAX - SAFE_MARGIN;
+            if (safe) {
+                ball_x[i] = nx;
+                ball_y[i] = ny;
+            } else {
+                resolve_collisions(i, dt);
+            }
+        }
+    }
+
+#ifdef T4P_X86_SIMD
+    void step_paddles_sse(float dt, int begin, int end) {
+        const __m128 step = _mm_set1_ps(PADDLE_SPEED * dt);
+        const __m128 lo = _mm_set1_ps(PADDLE_MIN);
+        const __m128 hi = _mm_set1_ps(PADDLE_MAX);
+        
+        for (int p = 0; p < 4; p++) {
+            float* pos = paddle_pos[p].data();
+            const float* dir = paddle_dir[p].data();
+            for (int i = begin; i < end; i += 4) {
+                __m128 active = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&running[i]));
+                __m128 old_pos = _mm_loadu_ps(pos + i);
+                __m128 moved = _mm_add_ps(old_pos, _mm_mul_ps(_mm_loadu_ps(dir + i), step));
+                moved = _mm_min_ps(_mm_max_ps(moved, lo), hi);
+                _mm_storeu_ps(pos + i, _mm_or_ps(_mm_and_ps(active, moved), _mm_andnot_ps(active, old_pos)));
+            }
+        }
+    }
+    
+    void step_balls_sse(float dt, int begin, int end) {
+        const __m128 dtv = _mm_set1_ps(dt);
+        const __m128 lo = _mm_set1_ps(SAFE_MIN);
+        const __m128 hi = _mm_set1_ps(SAFE_MAX);
+        const __m128 lo_end = _mm_set1_ps(SAFE_MIN + SAFE_MARGIN);
+        const __m128 hi_end = _mm_set1_ps(SAFE_MAX - SAFE_MARGIN);
+        
+        for (int i = begin; i < end; i += 4) {
+            __m128 active = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)&running[i]));
+            __m128 x = _mm_loadu_ps(&ball_x[i]);
+            __m128 y = _mm_loadu_ps(&ball_y[i]);
+            __m128 nx = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(&ball_vx[i]), dtv));
+            __m128 ny = _mm_add_ps(y, _mm_mul_ps(_mm_loadu_ps(&ball_vy[i]), dtv));
+            
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(x, lo), _mm_cmple_ps(x, hi)),
+                                       _mm_and_ps(_mm_cmpge_ps(y, lo), _mm_cmple_ps(y, hi)));
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(nx, lo_end), _mm_cmple_ps(nx, hi_end)));
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(ny, lo_end), _mm_cmple_ps(ny, hi_end)));
+            
+            __m128 safe = _mm_and_ps(active, inside);
+            _mm_storeu_ps(&ball_x[i], _mm_or_ps(_mm_and_ps(safe, nx), _mm_andnot_ps(safe, x)));
+            _mm_storeu_ps(&ball_y[i], _mm_or_ps(_mm_and_ps(safe, ny), _mm_andnot_ps(safe, y)));
+            
+            int events = _mm_movemask_ps(_mm_andnot_ps(inside, active));
+            while (events) {
+                int lane = __builtin_ctz(events);
+                resolve_collisions(i + lane, dt);
+                events &= events - 1;
+            }
+        }
+    }
+    
+    __attribute__((target("avx2")))
+    void step_paddles_avx2(float dt, int begin, int end) {
+        const __m256 step = _mm256_set1_ps(PADDLE_SPEED * dt);
+        const __m256 lo = _mm256_set1_ps(PADDLE_MIN);
+        const __m256 hi = _mm256_set1_ps(PADDLE_MAX);
+        
+        for (int p = 0; p < 4; p++) {
+            float* pos = paddle_pos[p].data();
+            const float* dir = paddle_dir[p].data();
+            for (int i = begin; i < end; i += 8) {
+                __m256 active = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)&running[i]));
+                __m256 old_pos = _mm256_loadu_ps(pos + i);
+                __m256 moved = _mm256_add_ps(old_pos, _mm256_mul_ps(_mm256_loadu_ps(dir + i), step));
+                moved = _mm256_min_ps(_mm256_max_ps(moved, lo), hi);
+                _mm256_storeu_ps(pos + i, _mm256_blendv_ps(old_pos, moved, active));
+            }
+        }
+    }
+    
+    __attribute__((target("avx2")))
+    void step_balls_avx2(float dt, int begin, int end) {
+        const __m256 dtv = _mm256_set1_ps(dt);
+        const __m256 lo = _mm256_set1_ps(SAFE_MIN);
+        const __m256 hi = _mm256_set1_ps(SAFE_MAX);
+        const __m256 lo_end = _mm256_set1_ps(SAFE_MIN + SAFE_MARGIN);
+        const __m256 hi_end = _mm256_set1_ps(SAFE_MAX - SAFE_MARGIN);
+        
+        for (int i = begin; i < end; i += 8) {
+            __m256 active = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)&running[i]));
+            __m256 x = _mm256_loadu_ps(&ball_x[i]);
+            __m256 y = _mm256_loadu_ps(&ball_y[i]);
+            __m256 nx = _mm256_add_ps(x, _mm256_mul_ps(_mm256_loadu_ps(&ball_vx[i]), dtv));
+            __m256 ny = _mm256_add_ps(y, _mm256_mul_ps(_mm256_loadu_ps(&ball_vy[i]), dtv));
+            
+            __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(x, lo, _CMP_GE_OQ), _mm256_cmp_ps(x, hi, _CMP_LE_OQ)),
+                                          _mm256_and_ps(_mm256_cmp_ps(y, lo, _CMP_GE_OQ), _mm256_cmp_ps(y, hi, _CMP_LE_OQ)));
+            inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(nx, lo_end, _CMP_GE_OQ), _mm256_cmp_ps(nx, hi_end, _CMP_LE_OQ)));
+            inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(ny, lo_end, _CMP_GE_OQ), _mm256_cmp_ps(ny, hi_end, _CMP_LE_OQ)));
+            
+            __m256 safe = _mm256_and_ps(active, inside);
+            _mm256_storeu_ps(&ball_x[i], _mm256_blendv_ps(x, nx, safe));
+            _mm256_storeu_ps(&ball_y[i], _mm256_blendv_ps(y, ny, safe));
+            
+            int events = _mm256_movemask_ps(_mm256_andnot_ps(inside, active));
+            while (events) {
+                int lane = __builtin_ctz(events);
+                resolve_collisions(i + lane, dt);
+                events &= events - 1;
+            }
+        }
+    }
+#endif
+};
\ No newline at end of file
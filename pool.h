@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Pula obiektów wielokrotnego użytku o ograniczonej pojemności. Zwolniony
+// obiekt wraca na listę wolnych razem z pamięcią, którą sam trzyma (bufory
+// pierścieniowe, kontenery), więc po rozgrzaniu pobranie nie alokuje - także
+// przy dużej rotacji połączeń. Obiekty ponad pojemność są niszczone.
+// Jednowątkowa: obiekty zwalniane w innym wątku wracają przez SpscRing.
+template <typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(size_t capacity) : capacity(capacity) {
+        free_objects.reserve(capacity);
+    }
+    
+    // Wolny obiekt (w stanie z ostatniego użycia) albo nullptr, gdy pula jest pusta
+    std::unique_ptr<T> acquire() {
+        if (free_objects.empty()) return nullptr;
+        std::unique_ptr<T> object = std::move(free_objects.back());
+        free_objects.pop_back();
+        return object;
+    }
+    
+    void release(std::unique_ptr<T> object) {
+        if (free_objects.size() < capacity) {
+            free_objects.push_back(std::move(object));
+        }
+    }
+    
+    size_t available() const { return free_objects.size(); }
+    
+private:
+    size_t capacity;
+    std::vector<std::unique_ptr<T>> free_objects;
+};
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "common.h"
+#include "physics_batch.h"
+#include "replay.h"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Odtwarzanie powtórki meczu zapisanej przez serwer (argument katalogu powtórek).
+// Symulacja startuje ze stanu z nagłówka, a akcje są stosowane przed krokiem
+// o zapisanym numerze - tak jak w takcie serwera. Stan końcowy porównywany jest
+// z sumą kontrolną zapisaną przez serwer; różnica oznacza, że symulacja przestała
+// być deterministyczna (albo plik jest z innej wersji fizyki).
+//
+// Tryb --kernele sprawdza to, na czym opierają się powtórki: każdy kernel
+// BatchWorld (skalarny, SSE, AVX2 - dostępne na tym procesorze) krok po kroku
+// razem z GameState::update każdego pokoju, bit w bit (make check-physics).
+//
+// Użycie: ./the4pong_replay plik.t4r [co ile taktów wypisywać stan]
+//         ./the4pong_replay --kernele [takty] [ziarno]
+// Kod wyjścia: 0 zgodność (lub urwany zapis bez stopki), 1 błąd pliku, 2 niezgodność.
+
+using Clock = std::chrono::steady_clock;
+
+const int CHECK_ROOMS = 256;  // MAX_ROOMS shardu serwera
+const int CHECK_TICKS = 10000;
+// Co drugi takt świat jest liczony blokami slotów, jak w takcie shardu serwera
+const int CHECK_BLOCK_SLOTS = 4 * BatchWorld::LANES;
+// Skrajne i domyślna częstotliwość taktów - długi krok to seria odbić w jednym takcie
+const int CHECK_TICK_RATES[] = {MIN_TICK_RATE, DEFAULT_TICK_RATE, MAX_TICK_RATE};
+
+static uint32_t bits(float value) {
+    uint32_t result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// Porównanie bit w bit pól, które BatchWorld przechowuje dla pokoju
+static bool same_state(const GameState& a, const GameState& b) {
+    if (bits(a.ball.x) != bits(b.ball.x) || bits(a.ball.y) != bits(b.ball.y) ||
+        bits(a.ball.velocity_x) != bits(b.ball.velocity_x) || bits(a.ball.velocity_y) != bits(b.ball.velocity_y)) {
+        return false;
+    }
+    for (int p = 0; p < 4; p++) {
+        if (bits(a.paddles[p].position) != bits(b.paddles[p].position) ||
+            a.paddles[p].moving_left != b.paddles[p].moving_left ||
+            a.paddles[p].moving_right != b.paddles[p].moving_right || a.scores[p] != b.scores[p]) {
+            return false;
+        }
+    }
+    return a.game_running == b.game_running && a.rng_state == b.rng_state;
+}
+
+// Losowy pokój w trakcie gry. Co drugi startuje tuż przed linią platformy albo
+// za nią i leci w stronę ściany, z kulką na wysokości platformy lub jej krawędzi -
+// kolizje, utrata punktów i reset kulki w pierwszych taktach. Niskie wyniki
+// kończą część meczów szybko (pokój jest wtedy losowany od nowa).
+static GameState random_room(std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    GameState state;
+    state.game_running = true;
+    state.active_players = 4;
+    state.rng_state = ((uint64_t)rng() << 32) | rng();
+    
+    float angle = unit(rng) * 6.2831853f;
+    float speed = BALL_SPEED * (0.5f + 2.0f * unit(rng));
+    state.ball.velocity_x = speed * std::cos(angle);
+    state.ball.velocity_y = speed * std::sin(angle);
+    for (int p = 0; p < 4; p++) {
+        state.paddles[p].position = PADDLE_MIN + unit(rng) * (PADDLE_MAX - PADDLE_MIN);
+        state.paddles[p].set_action((PlayerAction)(rng() % 3));
+        state.scores[p] = 1 + rng() % INITIAL_SCORE;
+    }
+    
+    if (rng() % 2 == 0) {
+        state.ball.x = SAFE_MIN + unit(rng) * (SAFE_MAX - SAFE_MIN);
+        state.ball.y = SAFE_MIN + unit(rng) * (SAFE_MAX - SAFE_MIN);
+        return state;
+    }
+    
+    // Od -1 (za linią platformy) do 3 jednostek przed nią
+    float depth = -1.0f + 4.0f * unit(rng);
+    int paddle_id = rng() % 4;
+    float along = state.paddles[paddle_id].position + (unit(rng) - 0.5f) * PADDLE_SIZE * 1.2f;
+    float speed_across = std::max(std::fabs(state.ball.velocity_x), std::fabs(state.ball.velocity_y));
+    switch (paddle_id) {
+        case 0:  // północ
+            state.ball.x = along; state.ball.y = SAFE_MIN + depth;
+            state.ball.velocity_y = -speed_across;
+            break;
+        case 1:  // wschód
+            state.ball.y = along; state.ball.x = SAFE_MAX - depth;
+            state.ball.velocity_x = speed_across;
+            break;
+        case 2:  // południe
+            state.ball.x = along; state.ball.y = SAFE_MAX - depth;
+            state.ball.velocity_y = speed_across;
+            break;
+        case 3:  // zachód
+            state.ball.y = along; state.ball.x = SAFE_MIN + depth;
+            state.ball.velocity_x = -speed_across;
+            break;
+    }
+    return state;
+}
+
+struct KernelCheck {
+    BatchWorld::Kernel kernel;
+    const char* name;
+    uint64_t room_ticks;
+    std::string divergence;  // pusty = zgodność
+};
+
+// Jeden kernel dla wszystkich częstotliwości taktów. Ten sam ciąg losowy
+// (pokoje i akcje) dla każdego kernela.
+static void check_kernel(KernelCheck& check, int ticks, uint32_t seed) {
+    for (int tick_rate : CHECK_TICK_RATES) {
+        std::mt19937 rng(seed);
+        const float dt = 1.0f / tick_rate;
+        BatchWorld world(CHECK_ROOMS);
+        world.set_kernel(check.kernel);
+        std::vector<GameState> rooms(CHECK_ROOMS);
+        for (int slot = 0; slot < CHECK_ROOMS; slot++) {
+            rooms[slot] = random_room(rng);
+            world.load(slot, rooms[slot]);
+        }
+        
+        for (int tick = 0; tick < ticks; tick++) {
+            for (int slot = 0; slot < CHECK_ROOMS; slot++) {
+                if (!rooms[slot].game_running) {
+                    rooms[slot] = random_room(rng);
+                    world.load(slot, rooms[slot]);
+                }
+                if (rng() % 16 == 0) {
+                    int player = rng() % 4;
+                    PlayerAction action = (PlayerAction)(rng() % 3);
+                    rooms[slot].paddles[player].set_action(action);
+                    world.set_action(slot, player, action);
+                }
+            }
+            
+            if (tick % 2 == 0) {
+                world.step(dt);
+            } else {
+                for (int begin = 0; begin < world.size(); begin += CHECK_BLOCK_SLOTS) {
+                    world.step(dt, begin, begin + CHECK_BLOCK_SLOTS);
+                }
+            }
+            
+            for (int slot = 0; slot < CHECK_ROOMS; slot++) {
+                GameState before = rooms[slot];
+                rooms[slot].update(dt);
+                GameState batched = rooms[slot];
+                world.store(slot, batched);
+                if (!same_state(rooms[slot], batched)) {
+                    char message[256];
+                    snprintf(message, sizeof(message),
+                             "%d taktów/s, takt %d, pokój %d: kulka (%a, %a) zamiast (%a, %a), start z (%a, %a) v (%a, %a)",
+                             tick_rate, tick, slot, batched.ball.x, batched.ball.y,
+                             rooms[slot].ball.x, rooms[slot].ball.y, before.ball.x, before.ball.y,
+                             before.ball.velocity_x, before.ball.velocity_y);
+                    check.divergence = message;
+                    return;
+                }
+            }
+            check.room_ticks += CHECK_ROOMS;
+        }
+    }
+}
+
+// Każdy kernel w osobnym wątku - także stan pomocniczy kolizji (thread_local)
+// jest wtedy używany współbieżnie
+static int check_kernels(int ticks, uint32_t seed) {
+    std::vector<KernelCheck> checks = {
+        {BatchWorld::KERNEL_SCALAR, "scalar", 0, ""},
+        {BatchWorld::KERNEL_SSE, "sse", 0, ""},
+        {BatchWorld::KERNEL_AVX2, "avx2", 0, ""},
+    };
+    checks.erase(std::remove_if(checks.begin(), checks.end(),
+                                [](const KernelCheck& check) { return check.kernel > BatchWorld::best_kernel(); }),
+                 checks.end());
+    
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (auto& check : checks) {
+        threads.emplace_back(check_kernel, std::ref(check), ticks, seed);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    int result = 0;
+    for (const auto& check : checks) {
+        if (check.divergence.empty()) {
+            printf("%-7s zgodny z GameState::update: %llu kroków pokoi\n", check.name,
+                   (unsigned long long)check.room_ticks);
+        } else {
+            printf("%-7s NIEZGODNOŚĆ po %llu krokach pokoi - %s\n", check.name,
+                   (unsigned long long)check.room_ticks, check.divergence.c_str());
+            result = 2;
+        }
+    }
+    printf("Ziarno %u, %d taktów na częstotliwość, %.1f s\n", seed, ticks, seconds);
+    return result;
+}
+
+static void print_state(uint32_t tick, const GameState& state) {
+    printf("%8u  kulka (%7.2f, %7.2f) v (%7.2f, %7.2f)  platformy %6.2f %6.2f %6.2f %6.2f  wynik %d %d %d %d\n",
+           tick, state.ball.x, state.ball.y, state.ball.velocity_x, state.ball.velocity_y,
+           state.paddles[0].position, state.paddles[1].position,
+           state.paddles[2].position, state.paddles[3].position,
+           state.scores[0], state.scores[1], state.scores[2], state.scores[3]);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Użycie: " << argv[0] << " plik.t4r [co ile taktów wypisywać stan]\n"
+                  << "        " << argv[0] << " --kernele [takty] [ziarno]\n";
+        return 1;
+    }
+    if (std::string(argv[1]) == "--kernele") {
+        int ticks = argc > 2 ? std::atoi(argv[2]) : CHECK_TICKS;
+        uint32_t seed = argc > 3 ? (uint32_t)std::strtoul(argv[3], nullptr, 10) : 1;
+        return check_kernels(ticks, seed);
+    }
+    int print_every = argc > 2 ? std::atoi(argv[2]) : 0;
+    
+    Replay replay;
+    std::string error;
+    if (!load_replay(argv[1], replay, error)) {
+        std::cerr << "Błąd: " << error << "\n";
+        return 1;
+    }
+    const ReplayHeader& header = replay.header;
+    if (header.tick_rate < MIN_TICK_RATE || header.tick_rate > MAX_TICK_RATE) {
+        std::cerr << "Błąd: niepoprawna częstotliwość taktów " << header.tick_rate << "\n";
+        return 1;
+    }
+    
+    // Urwany zapis: odtwarzanie do ostatniej akcji, bez weryfikacji
+    uint32_t end_tick = replay.finished ? replay.end_record.tick
+                                        : (replay.actions.empty() ? 0 : replay.actions.back().tick + 1);
+    
+    printf("Pokój %u, %u taktów/s, ziarno %016llx, %zu akcji, %u taktów (%.1f s gry)\n",
+           header.room_id, header.tick_rate, (unsigned long long)header.seed,
+           replay.actions.size(), end_tick, (double)end_tick / header.tick_rate);
+    
+    GameState state;
+    replay_state_from_header(header, state);
+    const float dt = 1.0f / header.tick_rate;
+    
+    auto start = Clock::now();
+    size_t next = 0;
+    for (uint32_t tick = 0; tick < end_tick; tick++) {
+        while (next < replay.actions.size() && replay.actions[next].tick == tick) {
+            const ReplayRecord& record = replay.actions[next++];
+            if (record.player_id < 4 && record.action <= ACTION_STOP) {
+                state.paddles[record.player_id].set_action((PlayerAction)record.action);
+            }
+        }
+        state.update(dt);
+        
+        if (print_every > 0 && (tick + 1) % print_every == 0) {
+            print_state(tick + 1, state);
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    printf("Odtworzono w %.3f ms (%.0fx szybciej niż w grze)\n", seconds * 1e3,
+           seconds > 0 ? (double)end_tick / header.tick_rate / seconds : 0.0);
+    print_state(end_tick, state);
+    
+    if (next < replay.actions.size()) {
+        printf("Uwaga: %zu akcji po ostatnim takcie zostało pominiętych\n", replay.actions.size() - next);
+    }
+    if (!replay.finished) {
+        printf("Zapis urwany (brak rekordu końca) - stanu końcowego nie da się zweryfikować\n");
+        return 0;
+    }
+    
+    uint64_t checksum = state_checksum(state);
+    bool scores_match = true;
+    for (int p = 0; p < 4; p++) {
+        if (state.scores[p] != replay.footer.scores[p]) scores_match = false;
+    }
+    const char* ending = replay.end_record.kind == REPLAY_END ? "koniec gry" : "pokój opuszczony";
+    if (checksum == replay.footer.checksum && scores_match) {
+        printf("Stan końcowy zgodny (%s), suma %016llx\n", ending, (unsigned long long)checksum);
+        return 0;
+    }
+    
+    printf("NIEZGODNOŚĆ (%s): suma %016llx, oczekiwano %016llx; wynik serwera %d %d %d %d\n",
+           ending, (unsigned long long)checksum, (unsigned long long)replay.footer.checksum,
+           replay.footer.scores[0], replay.footer.scores[1], replay.footer.scores[2], replay.footer.scores[3]);
+    return 2;
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+#include "common.h"
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Zapis meczu do powtórki: stan początkowy pokoju (z ziarnem generatora
+// losowego) i strumień zastosowanych akcji z numerem taktu. Symulacja jest
+// deterministyczna (stały krok, bez FMA, generator w stanie pokoju), więc
+// odtworzenie tych samych akcji w tych samych taktach przez GameState::update
+// daje bit w bit ten sam przebieg - co potwierdza suma kontrolna stanu końcowego.
+//
+// Plik (natywny układ struktur, little-endian):
+//   ReplayHeader
+//   ReplayRecord*            akcje w kolejności taktów
+//   ReplayRecord (END/ABORT) + ReplayFooter
+// Plik jest tylko dopisywany; urwany zapis (awaria serwera) da się odtworzyć
+// do ostatniej zapisanej akcji, tylko bez weryfikacji stanu końcowego.
+
+const char REPLAY_MAGIC[4] = {'T', '4', 'P', 'R'};
+const uint16_t REPLAY_VERSION = 1;
+
+enum ReplayRecordKind : uint8_t {
+    REPLAY_ACTION = 1,  // akcja gracza zastosowana przed krokiem o numerze tick
+    REPLAY_END = 2,     // gra zakończona normalnie po tick krokach
+    REPLAY_ABORT = 3    // pokój opustoszał w trakcie gry po tick krokach
+};
+
+struct ReplayHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t tick_rate;
+    uint32_t room_id;
+    uint32_t reserved;
+    uint64_t start_time_ms;  // czas uniksowy rozpoczęcia meczu
+    uint64_t seed;           // GameState::rng_state w chwili startu
+    float ball[4];           // x, y, vx, vy
+    float paddle_pos[4];
+    int32_t paddle_dir[4];   // -1 w lewo, 0 stop, 1 w prawo
+    int32_t scores[4];
+};
+static_assert(sizeof(ReplayHeader) == 96, "Układ nagłówka powtórki nie może się zmieniać");
+
+struct ReplayRecord {
+    uint32_t tick;         // krok meczu (0 = pierwszy krok po starcie)
+    uint32_t received_us;  // odebranie datagramu z akcją, µs od startu meczu
+    uint8_t kind;
+    uint8_t player_id;
+    uint8_t action;
+    uint8_t reserved;
+};
+static_assert(sizeof(ReplayRecord) == 12, "Układ rekordu powtórki nie może się zmieniać");
+
+struct ReplayFooter {
+    uint64_t checksum;  // state_checksum stanu po ostatnim kroku
+    int32_t scores[4];
+};
+static_assert(sizeof(ReplayFooter) == 24, "Układ stopki powtórki nie może się zmieniać");
+
+// Suma kontrolna (FNV-1a) stanu symulacji - bity liczb float, nie ich wartości
+inline uint64_t state_checksum(const GameState& state) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto mix = [&hash](const void* data, size_t length) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+    };
+    
+    mix(&state.ball.x, sizeof(float));
+    mix(&state.ball.y, sizeof(float));
+    mix(&state.ball.velocity_x, sizeof(float));
+    mix(&state.ball.velocity_y, sizeof(float));
+    for (const Paddle& paddle : state.paddles) {
+        mix(&paddle.position, sizeof(float));
+    }
+    for (int score : state.scores) {
+        int32_t value = score;
+        mix(&value, sizeof(value));
+    }
+    mix(&state.rng_state, sizeof(state.rng_state));
+    return hash;
+}
+
+inline void replay_header_from_state(ReplayHeader& header, const GameState& state) {
+    header.seed = state.rng_state;
+    header.ball[0] = state.ball.x;
+    header.ball[1] = state.ball.y;
+    header.ball[2] = state.ball.velocity_x;
+    header.ball[3] = state.ball.velocity_y;
+    for (int p = 0; p < 4; p++) {
+        const Paddle& paddle = state.paddles[p];
+        header.paddle_pos[p] = paddle.position;
+        header.paddle_dir[p] = paddle.moving_left == paddle.moving_right ? 0 : (paddle.moving_left ? -1 : 1);
+        header.scores[p] = state.scores[p];
+    }
+}
+
+inline void replay_state_from_header(const ReplayHeader& header, GameState& state) {
+    state = GameState();
+    state.rng_state = header.seed;
+    state.ball.x = header.ball[0];
+    state.ball.y = header.ball[1];
+    state.ball.velocity_x = header.ball[2];
+    state.ball.velocity_y = header.ball[3];
+    for (int p = 0; p < 4; p++) {
+        Paddle& paddle = state.paddles[p];
+        paddle.position = header.paddle_pos[p];
+        paddle.moving_left = header.paddle_dir[p] < 0;
+        paddle.moving_right = header.paddle_dir[p] > 0;
+        state.scores[p] = header.scores[p];
+    }
+    state.game_running = true;
+}
+
+// Zapis powtórki jednego meczu. Rekordy trafiają do bufora stdio, więc
+// zapis akcji w takcie to tylko kopia 12 bajtów; na dysk trafiają wsadami.
+class ReplayWriter {
+public:
+    ReplayWriter() : file(nullptr) {}
+    ~ReplayWriter() { close(); }
+    
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+    
+    bool open(const std::string& path, const ReplayHeader& header) {
+        close();
+        file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+        fwrite(&header, sizeof(header), 1, file);
+        return true;
+    }
+    
+    bool is_open() const { return file != nullptr; }
+    
+    void action(uint32_t tick, uint32_t received_us, int player_id, PlayerAction action) {
+        if (!file) return;
+        ReplayRecord record{tick, received_us, REPLAY_ACTION, (uint8_t)player_id, (uint8_t)action, 0};
+        fwrite(&record, sizeof(record), 1, file);
+    }
+    
+    // Zamyka zapis rekordem końca i sumą kontrolną stanu po tick krokach
+    void finish(ReplayRecordKind kind, uint32_t tick, const GameState& state) {
+        if (!file) return;
+        ReplayRecord record{tick, 0, kind, 0, 0, 0};
+        ReplayFooter footer{state_checksum(state), {}};
+        for (int p = 0; p < 4; p++) footer.scores[p] = state.scores[p];
+        fwrite(&record, sizeof(record), 1, file);
+        fwrite(&footer, sizeof(footer), 1, file);
+        close();
+    }
+    
+    void close() {
+        if (file) fclose(file);
+        file = nullptr;
+    }
+    
+private:
+    FILE* file;
+};
+
+// Wczytana powtórka
+struct Replay {
+    ReplayHeader header;
+    std::vector<ReplayRecord> actions;
+    bool finished = false;       // jest rekord END/ABORT
+    ReplayRecord end_record{};
+    ReplayFooter footer{};
+};
+
+// Wczytuje plik powtórki; error opisuje przyczynę niepowodzenia
+inline bool load_replay(const std::string& path, Replay& replay, std::string& error) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "nie można otworzyć pliku " + path;
+        return false;
+    }
+    
+    bool ok = fread(&replay.header, sizeof(replay.header), 1, file) == 1;
+    if (!ok || memcmp(replay.header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+        error = "to nie jest plik powtórki";
+        fclose(file);
+        return false;
+    }
+    if (replay.header.version != REPLAY_VERSION) {
+        error = "nieobsługiwana wersja powtórki " + std::to_string(replay.header.version);
+        fclose(file);
+        return false;
+    }
+    
+    ReplayRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (record.kind == REPLAY_ACTION) {
+            replay.actions.push_back(record);
+            continue;
+        }
+        if ((record.kind == REPLAY_END || record.kind == REPLAY_ABORT) &&
+            fread(&replay.footer, sizeof(replay.footer), 1, file) == 1) {
+            replay.finished = true;
+            replay.end_record = record;
+        }
+        break;
+    }
+    
+    fclose(file);
+    return true;
+}
\ No newline at end of file
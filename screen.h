@@ -0,0 +1,94 @@
+#pragma once
+#include <ncurses.h>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// Podwójnie buforowany ekran terminala: klatka jest rysowana do siatki komórek
+// (znak + para kolorów) w pamięci, a do ncurses trafiają tylko komórki różne
+// od poprzedniej klatki. Zamiast clear() i przerysowania wszystkiego co takt
+// terminal dostaje kilka-kilkanaście znaków (kulka, poruszone platformy).
+//
+// Stała część obrazu (ramka, napisy) jest rysowana raz do warstwy tła
+// (save_layer) i kopiowana na początku każdej klatki (restore_layer).
+struct Cell {
+    char ch;
+    uint8_t color;  // para kolorów ncurses, 0 = domyślne
+    
+    bool operator==(const Cell& other) const { return ch == other.ch && color == other.color; }
+    bool operator!=(const Cell& other) const { return !(*this == other); }
+};
+
+class ScreenBuffer {
+public:
+    ScreenBuffer() : rows(0), cols(0), colors(false) {}
+    
+    // Dopasowuje siatkę do rozmiaru terminala. Zwraca true po zmianie rozmiaru -
+    // wtedy następna klatka jest wysyłana w całości, a warstwę tła trzeba narysować od nowa.
+    bool resize(int new_rows, int new_cols) {
+        if (new_rows == rows && new_cols == cols) return false;
+        rows = new_rows;
+        cols = new_cols;
+        colors = has_colors();
+        size_t cells = (size_t)std::max(0, rows) * std::max(0, cols);
+        back.assign(cells, BLANK);
+        layer.assign(cells, BLANK);
+        // Znak spoza zakresu - każda komórka nowej klatki różni się od "poprzedniej"
+        front.assign(cells, Cell{0, 0xFF});
+        clear();
+        return true;
+    }
+    
+    int height() const { return rows; }
+    int width() const { return cols; }
+    
+    void clear_cells() { std::fill(back.begin(), back.end(), BLANK); }
+    void save_layer() { layer = back; }
+    void restore_layer() { back = layer; }
+    
+    void put(int y, int x, char ch, uint8_t color = 0) {
+        if (y < 0 || y >= rows || x < 0 || x >= cols) return;
+        back[(size_t)y * cols + x] = Cell{ch, color};
+    }
+    
+    void text(int y, int x, const char* str, uint8_t color = 0) {
+        for (; *str; str++, x++) {
+            put(y, x, *str, color);
+        }
+    }
+    
+    // Wysyła do terminala komórki zmienione od poprzedniej klatki; zwraca ich liczbę
+    int present() {
+        int changed = 0;
+        int current_color = -1;
+        for (int y = 0; y < rows; y++) {
+            for (int x = 0; x < cols; x++) {
+                size_t i = (size_t)y * cols + x;
+                if (back[i] == front[i]) continue;
+                
+                if (colors && back[i].color != current_color) {
+                    attrset(back[i].color ? COLOR_PAIR(back[i].color) : A_NORMAL);
+                    current_color = back[i].color;
+                }
+                // Prawy dolny róg przewinąłby ekran przy zapisie - pomijany
+                if (y != rows - 1 || x != cols - 1) {
+                    mvaddch(y, x, back[i].ch);
+                }
+                front[i] = back[i];
+                changed++;
+            }
+        }
+        if (colors) attrset(A_NORMAL);
+        if (changed > 0) refresh();
+        return changed;
+    }
+    
+private:
+    static constexpr Cell BLANK{' ', 0};
+    
+    int rows, cols;
+    bool colors;
+    std::vector<Cell> back;   // rysowana klatka
+    std::vector<Cell> front;  // to, co jest na ekranie
+    std::vector<Cell> layer;  // warstwa tła (ramka i napisy)
+};
\ No newline at end of file
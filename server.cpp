@@ -1,65 +1,1706 @@
 #include "common.h"
+#include "physics_batch.h"
+#include "snapshot.h"
+#include "udp_batch.h"
+#include "spsc_ring.h"
+#include "logger.h"
+#include "metrics.h"
+#include "replay.h"
+#include "framing.h"
+#include "wire.h"
+#include "alloc_count.h"
+#include "pool.h"
 #include <iostream>
-#include <thread>
-#include <mutex>
-#include <queue>
 #include <chrono>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <linux/filter.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
 #include <cstring>
 #include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <random>
+#include <ctime>
+#include <atomic>
+#include <thread>
+#include <pthread.h>
+
+struct PlayerConnection {
+    int tcp_socket;
+    int udp_socket;
+    sockaddr_in udp_addr;
+    char nick[sizeof(JoinLobbyPacket::nick)];  // bez alokacji - gracze leżą w tablicy pokoju
+    bool connected;
+    bool ready;
+    bool udp_bound;          // czy znamy adres UDP (pierwszy pakiet z poprawnym tokenem)
+    uint64_t session_token;
+    bool snapshot_acked;     // czy klient potwierdził już jakąkolwiek migawkę
+    uint16_t acked_snapshot; // najnowsza potwierdzona migawka - baza dla różnic
+    uint32_t received_seq;   // najnowsze odebrane wejście (deduplikacja powtórzeń)
+    uint32_t input_seq;      // ostatnie zastosowane wejście gracza (0 = brak)
+    uint64_t input_tick;     // takt, w którym je zastosowano
+    float rtt;               // wygładzony czas migawka -> potwierdzenie (sekundy, 0 = brak)
+    
+    PlayerConnection() : tcp_socket(-1), udp_socket(-1), udp_addr{}, nick{}, connected(false), ready(false),
+                         udp_bound(false), session_token(0), snapshot_acked(false), acked_snapshot(0), received_seq(0), input_seq(0),
+                         input_tick(0), rtt(0.0f) {}
+};
+
+struct ActionEvent {
+    int player_id;
+    PlayerAction action;
+    uint32_t input_seq;
+    std::chrono::steady_clock::time_point timestamp;
+};
+
+// Maksymalna liczba pokoi obsługiwanych przez jeden wątek roboczy (shard)
+const int MAX_ROOMS = 256;
+
+// Maksymalna liczba wątków roboczych
+const int MAX_SHARDS = 64;
+
+// Token sesji: najstarszy bajt to numer shardu, pozostałe 56 bitów jest losowych
+const int TOKEN_SHARD_SHIFT = 56;
+
+// Przesunięcie najstarszego bajtu tokenu w datagramie klienta: bajt typu, a za nim
+// token jako pierwsze pole schematu (64 bity little-endian) w UDP_BIND,
+// PLAYER_ACTION i SNAPSHOT_ACK
+const uint32_t DATAGRAM_SHARD_OFFSET = 1 + 7;
+
+// Pojemność kolejki połączeń przekazywanych shardowi (potęga dwójki); tyle samo
+// mieści kolejka zamkniętych połączeń wracających do puli wątku przyjmującego
+const size_t SHARD_HANDOFF_CAPACITY = 1024;
+
+// Zamknięte połączenia (z buforami ~20 KB) czekające na ponowne użycie
+const size_t CONNECTION_POOL_CAPACITY = 1024;
+
+// Takt shardu jest dzielony na bloki tylu slotów pokoi (wielokrotność szerokości
+// kernela BatchWorld); bloki bez trwających meczów są pomijane, a resztę mogą
+// podebrać inne shardy
+const int TICK_BLOCK_SLOTS = 32;
+const int TICK_BLOCKS = MAX_ROOMS / TICK_BLOCK_SLOTS;
+static_assert(TICK_BLOCK_SLOTS % BatchWorld::LANES == 0 && MAX_ROOMS % TICK_BLOCK_SLOTS == 0,
+              "Bloki taktu muszą dzielić sloty równo i w granicach kerneli");
+
+// Takt dłuższy niż to budzi do pomocy uśpione shardy (bez meczów, więc bez własnego taktu)
+const uint64_t HELP_TICK_NANOS = 500000;
+
+// Katalog nazwanych pokoi jest czyszczony z wpisów zamkniętych pokoi, gdy urośnie
+// do tej liczby (albo dwukrotności rozmiaru po poprzednim czyszczeniu)
+const size_t ROUTES_PRUNE_MIN = 1024;
+
+// Maksymalna liczba zdarzeń odbieranych z epoll_wait naraz
+const int MAX_EPOLL_EVENTS = 256;
+
+// Pojemność kolejki akcji pokoju (potęga dwójki). Przy 4 graczach i kilku
+// akcjach na takt zapełnia się tylko przy zalewaniu serwera pakietami.
+const size_t ACTION_QUEUE_CAPACITY = 64;
+
+// Największe opóźnienie transmisji dla widzów (historia migawek pokoju)
+const int MAX_SPECTATOR_DELAY_MS = 10000;
+
+// Waga nowej próbki w wygładzanym RTT gracza
+const float RTT_SMOOTHING = 0.125f;
+
+// Maksymalny czas wysyłania odpowiedzi ze statystykami (wolny odbiorca nie blokuje taktu)
+const int STATS_SEND_TIMEOUT_MS = 100;
+
+// Metryki wątku roboczego; punkt statystyk eksportuje ich sumę (format Prometheusa)
+struct ServerMetrics {
+    Counter ticks;
+    Counter udp_malformed;       // za krótkie lub nieznanego typu
+    Counter udp_unknown_token;   // poprawne, ale z nieznanym tokenem sesji
+    Counter actions_received;
+    Counter actions_dropped;     // pełna kolejka akcji pokoju
+    Counter snapshots_sent;
+    Counter snapshot_bytes;
+    Counter spectator_snapshots;  // migawki wysłane widzom (jedno kodowanie na pokój)
+    Counter tcp_frames_sent;
+    Counter tcp_send_syscalls;
+    Counter tcp_slow_closed;      // połączenia zerwane, bo odbiorca nie odbierał komunikatów
+    Counter tick_blocks;          // bloki pokoi z trwającymi meczami przetworzone w taktach
+    Counter tick_blocks_stolen;   // ...w tym przez inne shardy
+    Counter tick_allocations;     // alokacje na stercie w taktach (tylko COUNT_ALLOCS=1)
+    std::atomic<uint64_t> queue_depth_peak;  // największa głębokość kolejki akcji od ostatniego odczytu
+    LatencyHistogram tick_time;       // czas jednego taktu (akcje + symulacja + migawki)
+    LatencyHistogram action_latency;  // odbiór datagramu -> zastosowanie akcji w takcie
+    LatencyHistogram sync_fanout;     // takty z migawkami: bloki pokoi łącznie z kodowaniem i wysłaniem
+    LatencyHistogram sync_interval;   // odstęp między kolejnymi rozesłaniami migawek
+    LatencyHistogram rtt;             // migawka -> potwierdzenie SNAPSHOT_ACK
+    
+    ServerMetrics() : queue_depth_peak(0) {}
+    
+    // Dolicza liczniki i histogramy innego shardu (bez queue_depth_peak - to maksimum)
+    void add(const ServerMetrics& other) {
+        ticks.add(other.ticks.get());
+        udp_malformed.add(other.udp_malformed.get());
+        udp_unknown_token.add(other.udp_unknown_token.get());
+        actions_received.add(other.actions_received.get());
+        actions_dropped.add(other.actions_dropped.get());
+        snapshots_sent.add(other.snapshots_sent.get());
+        snapshot_bytes.add(other.snapshot_bytes.get());
+        spectator_snapshots.add(other.spectator_snapshots.get());
+        tcp_frames_sent.add(other.tcp_frames_sent.get());
+        tcp_send_syscalls.add(other.tcp_send_syscalls.get());
+        tcp_slow_closed.add(other.tcp_slow_closed.get());
+        tick_blocks.add(other.tick_blocks.get());
+        tick_blocks_stolen.add(other.tick_blocks_stolen.get());
+        tick_allocations.add(other.tick_allocations.get());
+        tick_time.add(other.tick_time);
+        action_latency.add(other.action_latency);
+        sync_fanout.add(other.sync_fanout);
+        sync_interval.add(other.sync_interval);
+        rtt.add(other.rtt);
+    }
+};
+
+// Widz pokoju - tylko odbiera migawki, nie zajmuje miejsca gracza
+struct Spectator {
+    int tcp_socket;
+    uint64_t session_token;
+    sockaddr_in udp_addr;
+    bool udp_bound;
+    uint32_t rate_divisor;  // co która migawka pokoju trafia do widza
+    uint32_t delay_frames;  // opóźnienie w migawkach
+};
+
+// Migawka dla widzów zakodowana raz (z typem pakietu), wysyłana bez kopiowania
+struct SpectatorFrame {
+    uint16_t length;
+    uint8_t data[1 + SNAPSHOT_MAX_SIZE];
+};
+
+// Pokój - jeden mecz dla 4 graczy. Stan symulacji pokoju leży w slocie
+// BatchWorld swojego shardu; id jest unikalne w całym serwerze
+// (numer shardu * MAX_ROOMS + slot).
+struct Room {
+    int id;
+    int slot;
+    std::string name;  // pusta nazwa = pokój z szybkiej gry
+    bool in_use;
+    int log_counter;
+    std::array<PlayerConnection, 4> players;
+    // Odbiór sieci (producent) -> takt symulacji (konsument); bez blokad, więc
+    // żadna ze stron nie czeka na drugą, także gdy pracują w osobnych wątkach
+    SpscRing<ActionEvent, ACTION_QUEUE_CAPACITY> action_queue;
+    uint64_t dropped_actions;  // akcje odrzucone przy pełnej kolejce
+    SnapshotHistory snapshots;  // ostatnio wysłane migawki (bazy dla różnic)
+    uint16_t snapshot_seq;
+    // Czas wysłania migawek z historii (pomiar RTT z potwierdzeń)
+    std::array<std::chrono::steady_clock::time_point, SNAPSHOT_HISTORY> snapshot_sent;
+    std::vector<Spectator> spectators;
+    // Ostatnie migawki widzów (pierścień - źródło opóźnionej transmisji);
+    // przydzielany przy pierwszym widzu w slocie i używany przez kolejne pokoje
+    // w nim, zasilany od pierwszego widza do zwolnienia pokoju (spectator_feed)
+    std::vector<SpectatorFrame> spectator_frames;
+    bool spectator_feed;
+    uint32_t spectator_sync;  // liczba zakodowanych migawek widzów
+    ReplayWriter replay;   // zapis powtórki bieżącego meczu (gdy włączony)
+    uint32_t match_tick;   // kroki symulacji od startu meczu (numeracja akcji w powtórce)
+    std::chrono::steady_clock::time_point match_start;
+    // Kopia PlayerConnection::rtt dla punktu statystyk (czytana z innego wątku)
+    std::array<std::atomic<float>, 4> rtt_gauge;
+    
+    Room(int room_id, int world_slot) : id(room_id), slot(world_slot), in_use(false), log_counter(0),
+                                        dropped_actions(0), snapshot_seq(0), spectator_feed(false), spectator_sync(0),
+                                        match_tick(0) {
+        for (auto& gauge : rtt_gauge) gauge.store(0.0f, std::memory_order_relaxed);
+    }
+    
+    int free_slot() const {
+        for (int i = 0; i < 4; i++) {
+            if (!players[i].connected) return i;
+        }
+        return -1;
+    }
+    
+    bool empty() const {
+        for (const auto& player : players) {
+            if (player.connected) return false;
+        }
+        return true;
+    }
+    
+    void reset() {
+        name.clear();
+        in_use = false;
+        log_counter = 0;
+        players = std::array<PlayerConnection, 4>();
+        action_queue.clear();
+        dropped_actions = 0;
+        snapshots.clear();
+        snapshot_seq = 0;
+        spectators.clear();
+        spectator_feed = false;
+        spectator_sync = 0;
+        replay.close();
+        match_tick = 0;
+        for (auto& gauge : rtt_gauge) gauge.store(0.0f, std::memory_order_relaxed);
+    }
+};
+
+// Gracz wskazywany przez token sesji z pakietów UDP
+struct SessionRef {
+    Room* room;
+    int player_id;  // SPECTATOR_ID dla widza
+};
+
+const int SPECTATOR_ID = -1;
+
+// Etap połączenia TCP
+enum ConnectionStage {
+    STAGE_HELLO,        // oczekiwanie na HELLO (uzgodnienie wersji protokołu)
+    STAGE_SELECT_ROOM,  // oczekiwanie na CREATE_JOIN_SERVER lub JOIN_LOBBY
+    STAGE_JOIN_LOBBY,   // miejsce zarezerwowane, oczekiwanie na JOIN_LOBBY
+    STAGE_IN_ROOM,      // gracz w pokoju (READY / LEAVE)
+    STAGE_SPECTATING    // widz pokoju (tylko LEAVE)
+};
+
+// Wpis katalogu nazwanych pokoi wątku przyjmującego: shard, w którym leży pokój.
+// Każde połączenie skierowane do pokoju trzyma kopię wskaźnika, więc wpis, do
+// którego odwołuje się już tylko katalog, oznacza pokój bez graczy i widzów -
+// zamknięty, a jego nazwa może trafić do innego shardu.
+struct RoomRoute {
+    int shard;
+};
+
+// Stan połączenia TCP obsługiwanego przez pętlę zdarzeń
+struct Connection {
+    int socket;
+    sockaddr_in addr;
+    ConnectionStage stage;
+    FrameReader reader;  // odebrane, jeszcze nieprzetworzone bajty
+    FrameWriter writer;  // komunikaty czekające na wysłanie
+    bool flush_queued;   // połączenie jest na liście do opróżnienia po serii zdarzeń
+    bool want_output;    // zarejestrowane EPOLLOUT (gniazdo nie przyjęło wszystkiego)
+    Room* room;
+    int player_id;
+    std::shared_ptr<RoomRoute> route;  // nazwany pokój, do którego skierowano połączenie
+    
+    Connection(int s, sockaddr_in a) : socket(s), addr(a), stage(STAGE_HELLO),
+                                       flush_queued(false), want_output(false), room(nullptr), player_id(-1) {}
+    
+    // Stan nowego połączenia w obiekcie z puli - bufory zostają przydzielone
+    void reset(int s, sockaddr_in a) {
+        socket = s;
+        addr = a;
+        stage = STAGE_HELLO;
+        reader.clear();
+        writer.clear();
+        flush_queued = false;
+        want_output = false;
+        room = nullptr;
+        player_id = -1;
+        route.reset();
+    }
+};
+
+// Obciążenie shardu widziane przez wątek przyjmujący. Liczbę połączeń zwiększa
+// wątek przyjmujący przy przekazaniu, a zmniejsza shard przy zamknięciu; resztę
+// shard publikuje po serii zdarzeń, która mogła zmienić pokoje.
+struct ShardLoad {
+    std::atomic<int> connections;
+    std::atomic<int> rooms_active;
+    std::atomic<int> players;
+    std::atomic<int> spectators;
+    std::atomic<int> open_quick_seats;       // wolne miejsca w czekających pokojach szybkiej gry
+    std::atomic<int> quick_rooms;            // zajęte pokoje szybkiej gry
+    std::atomic<int> watchable_quick_rooms;  // pokoje szybkiej gry z trwającym meczem
+    std::atomic<uint64_t> adopted;           // przyjęte przekazania (zapisywane po pozostałych polach)
+    std::atomic<bool> parked;                // bez trwających meczów - timer taktu zatrzymany
+    
+    ShardLoad() : connections(0), rooms_active(0), players(0), spectators(0), open_quick_seats(0),
+                  quick_rooms(0), watchable_quick_rooms(0), adopted(0), parked(true) {}
+};
+
+// Zadania bieżącego taktu shardu: bloki TICK_BLOCK_SLOTS slotów. Właściciel
+// i złodzieje (inne shardy po własnym takcie albo obudzone z uśpienia) pobierają
+// kolejne bloki przez CAS na słowie (numer taktu << 32 | następny blok), więc
+// złodziej ze słowem z poprzedniego taktu niczego nie pobierze. Każdy blok jest
+// pobierany raz; właściciel kończy takt, gdy done == TICK_BLOCKS.
+struct TickTasks {
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> state;
+    alignas(CACHE_LINE_SIZE) std::atomic<int> done;
+    
+    TickTasks() : state(TICK_BLOCKS), done(TICK_BLOCKS) {}
+};
+
+// Wątek roboczy (shard): grupa pokoi z własną pętlą zdarzeń, gniazdem UDP
+// (SO_REUSEPORT na porcie gry) i timerem taktu. Pokoje, połączenia TCP ich graczy
+// i widzów oraz sesje należą tylko do shardu, więc takt nie dzieli z innymi
+// wątkami niczego poza licznikami atomowymi.
+class RoomShard {
+private:
+    int index;
+    std::vector<std::unique_ptr<Room>> rooms;
+    BatchWorld world;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<int> pending_output;  // połączenia z komunikatami do wysłania (flush_connections)
+    std::unordered_map<uint64_t, SessionRef> sessions;  // token sesji -> gracz
+    std::mt19937_64 token_rng;
+    UdpRxBatch udp_in;   // odbiór datagramów wsadami (recvmmsg)
+    UdpTxBatch udp_out;  // wysyłka wsadami (sendmmsg), opróżniana po każdej serii zdarzeń
+    ServerMetrics metrics;
+    alignas(CACHE_LINE_SIZE) ShardLoad load;
+    TickTasks tasks;
+    uint64_t tick_generation;
+    std::vector<RoomShard*> peers;  // wszystkie shardy serwera (także ten) - źródło bloków do podebrania
+    // Wątek przyjmujący (producent) -> pętla shardu (konsument), sygnalizowane przez wake_fd
+    SpscRing<Connection*, SHARD_HANDOFF_CAPACITY> handoffs;
+    SpscRing<Connection*, SHARD_HANDOFF_CAPACITY> recycled;  // zamknięte połączenia dla puli wątku przyjmującego
+    uint64_t adopted_count;
+    bool load_changed;  // pokoje mogły się zmienić od ostatniego publish_load
+    std::chrono::steady_clock::time_point tick_start;
+    std::chrono::steady_clock::time_point last_sync;
+    uint64_t last_tick_nanos;
+    bool sync_due;  // bieżący takt rozsyła migawki
+    int port;
+    std::string replay_dir;  // katalog powtórek meczów (pusty = bez zapisu)
+    int udp_socket;
+    int epoll_fd;
+    int tick_timer;
+    int wake_fd;
+    std::atomic<bool> running;
+    std::thread thread;
+    int tick_rate;
+    float tick_dt;
+    int sync_interval_ticks;
+    int spectator_history;  // długość pierścienia migawek widzów (MAX_SPECTATOR_DELAY_MS)
+    uint64_t tick_count;
+
+public:
+    RoomShard(int index, int tick_rate, const std::string& replay_dir)
+        : index(index), world(MAX_ROOMS), tick_generation(0), adopted_count(0), load_changed(false),
+          last_tick_nanos(0), sync_due(false), port(-1), replay_dir(replay_dir),
+          udp_socket(-1), epoll_fd(-1), tick_timer(-1), wake_fd(-1), running(false),
+          tick_rate(tick_rate), tick_dt(1.0f / tick_rate),
+          sync_interval_ticks(std::max(1, tick_rate / SYNC_RATE)),
+          spectator_history(MAX_SPECTATOR_DELAY_MS * (tick_rate / sync_interval_ticks) / 1000 + 1), tick_count(0) {
+        std::random_device seed;
+        token_rng.seed(((uint64_t)seed() << 32) ^ seed());
+        for (int i = 0; i < MAX_ROOMS; i++) {
+            rooms.push_back(std::make_unique<Room>(index * MAX_ROOMS + i, i));
+        }
+    }
+    
+    ~RoomShard() {
+        stop();
+    }
+    
+    // Gniazdo UDP w grupie SO_REUSEPORT portu gry, timer taktu i epoll shardu
+    bool open(int port) {
+        this->port = port;
+        
+        udp_socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        if (udp_socket < 0) {
+            LOG_ERROR("Błąd tworzenia UDP socket");
+            return false;
+        }
+        
+        int opt = 1;
+        setsockopt(udp_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+        
+        sockaddr_in server_addr{};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = INADDR_ANY;
+        server_addr.sin_port = htons(port);
+        
+        if (bind(udp_socket, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+            LOG_ERROR("Błąd bind UDP socket");
+            return false;
+        }
+        udp_in.set_socket(udp_socket);
+        udp_out.set_socket(udp_socket);
+        
+        // Timer taktu gry - uruchamiany przy starcie pierwszego meczu (unpark)
+        tick_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (tick_timer < 0) {
+            LOG_ERROR("Błąd tworzenia timerfd");
+            return false;
+        }
+        
+        wake_fd = eventfd(0, EFD_NONBLOCK);
+        epoll_fd = epoll_create1(0);
+        if (wake_fd < 0 || epoll_fd < 0) {
+            LOG_ERROR("Błąd tworzenia pętli zdarzeń wątku roboczego");
+            return false;
+        }
+        
+        watch(udp_socket);
+        watch(tick_timer);
+        watch(wake_fd);
+        return true;
+    }
+    
+    int udp_fd() const {
+        return udp_socket;
+    }
+    
+    // Przed start(): shardy, którym ten może podbierać bloki taktu
+    void set_peers(const std::vector<RoomShard*>& all) {
+        peers = all;
+    }
+    
+    // Uruchamia pętlę shardu w osobnym wątku, przypiętym do procesora cpu (-1 = bez przypinania)
+    void start(int cpu) {
+        running = true;
+        thread = std::thread(&RoomShard::run, this);
+        if (cpu < 0) return;
+        
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        int error = pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+        if (error != 0) {
+            LOG_WARN("Nie można przypiąć wątku roboczego " << index << " do procesora " << cpu << ": "
+                     << strerror(error));
+        }
+    }
+    
+    void stop() {
+        if (thread.joinable()) {
+            running = false;
+            wake();
+            thread.join();
+        }
+        
+        for (auto& entry : connections) {
+            close(entry.first);
+        }
+        connections.clear();
+        
+        // Połączenia przekazane, ale jeszcze nieprzyjęte
+        Connection* incoming;
+        while (handoffs.pop(incoming)) {
+            close(incoming->socket);
+            delete incoming;
+        }
+        while (recycled.pop(incoming)) {
+            delete incoming;
+        }
+        
+        if (udp_socket >= 0) close(udp_socket);
+        if (tick_timer >= 0) close(tick_timer);
+        if (wake_fd >= 0) close(wake_fd);
+        if (epoll_fd >= 0) close(epoll_fd);
+        udp_socket = tick_timer = wake_fd = epoll_fd = -1;
+    }
+    
+    // Wywoływane przez wątek przyjmujący: przekazuje połączenie (po uzgodnieniu wersji,
+    // z komunikatem wyboru pokoju w buforze) pętli shardu. Przy pełnej kolejce
+    // zwraca false, a połączenie zostaje u wywołującego.
+    bool hand_off(std::unique_ptr<Connection>& conn) {
+        load.connections.fetch_add(1, std::memory_order_relaxed);
+        Connection* incoming = conn.release();
+        if (!handoffs.push(incoming)) {
+            conn.reset(incoming);
+            load.connections.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        wake();
+        return true;
+    }
+    
+    // Wywoływane przez wątek przyjmujący: zamknięte połączenie do ponownego użycia
+    bool take_recycled(Connection*& conn) {
+        return recycled.pop(conn);
+    }
+    
+    // --- Odczyt z wątku przyjmującego (tylko wartości atomowe) ---
+    
+    const ShardLoad& current_load() const {
+        return load;
+    }
+    
+    const ServerMetrics& shard_metrics() const {
+        return metrics;
+    }
+    
+    const UdpRxBatch& udp_receiver() const {
+        return udp_in;
+    }
+    
+    const UdpTxBatch& udp_sender() const {
+        return udp_out;
+    }
+    
+    // Akcje oczekujące w kolejkach pokoi shardu (kolejki wolnych pokoi są puste)
+    uint64_t queued_actions() const {
+        uint64_t queued = 0;
+        for (const auto& room : rooms) {
+            queued += room->action_queue.size();
+        }
+        return queued;
+    }
+    
+    // Największa głębokość kolejki akcji od poprzedniego odczytu
+    uint64_t take_queue_depth_peak() {
+        return metrics.queue_depth_peak.exchange(0, std::memory_order_relaxed);
+    }
+    
+    void export_player_rtt(MetricsText& text) const {
+        for (const auto& room : rooms) {
+            for (int i = 0; i < 4; i++) {
+                float rtt = room->rtt_gauge[i].load(std::memory_order_relaxed);
+                if (rtt <= 0.0f) continue;
+                char labels[64];
+                snprintf(labels, sizeof(labels), "room=\"%d\",player=\"%d\"", room->id, i);
+                text.gauge_sample("the4pong_player_rtt_seconds", labels, rtt);
+            }
+        }
+    }
+    
+private:
+    // Pętla shardu: jego gniazdo UDP, połączenia TCP jego pokoi, takt gry
+    // i połączenia przekazane przez wątek przyjmujący
+    void run() {
+        epoll_event events[MAX_EPOLL_EVENTS];
+        
+        while (running) {
+            int count = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("Błąd epoll_wait: " << strerror(errno));
+                break;
+            }
+            
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                
+                if (fd == udp_socket) {
+                    handle_udp_messages();
+                } else if (fd == tick_timer) {
+                    uint64_t expirations;
+                    if (read(tick_timer, &expirations, sizeof(expirations)) > 0) {
+                        // Nadrób pominięte takty (ograniczone, by nie przyspieszać gry po zatrzymaniu)
+                        int ticks = (int)std::min<uint64_t>(expirations, MAX_CATCHUP_TICKS);
+                        for (int t = 0; t < ticks; t++) {
+                            game_loop();
+                        }
+                    }
+                    // Po własnym takcie - pomoc shardom, które jeszcze liczą swój
+                    help_peers();
+                } else if (fd == wake_fd) {
+                    adopt_connections();
+                    help_peers();
+                } else {
+                    handle_tcp_event(fd, events[i].events);
+                }
+            }
+            
+            // Komunikaty TCP z całej serii zdarzeń wychodzą razem, po jednym zapisie na połączenie
+            flush_connections();
+            if (load_changed) {
+                publish_load();
+            }
+        }
+    }
+    
+    void wake() {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG_ERROR("Błąd budzenia wątku roboczego " << index << ": " << strerror(errno));
+        }
+    }
+    
+    void watch(int fd) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+    
+    // Przyjmuje połączenia od wątku przyjmującego; komunikat wyboru pokoju (i to,
+    // co klient wysłał za nim) czeka już w buforze połączenia
+    void adopt_connections() {
+        uint64_t wakeups;
+        if (read(wake_fd, &wakeups, sizeof(wakeups)) < 0 && errno != EAGAIN) return;
+        
+        Connection* incoming;
+        while (handoffs.pop(incoming)) {
+            int fd = incoming->socket;
+            connections[fd] = std::unique_ptr<Connection>(incoming);
+            watch(fd);
+            adopted_count++;
+            load_changed = true;
+            process_messages(*incoming);
+        }
+    }
+    
+    // Stan pokoi dla wątku przyjmującego; adopted na końcu (release), więc wątek
+    // przyjmujący, który widzi wszystkie swoje przekazania jako przyjęte, widzi też
+    // wolne miejsca po ich obsłużeniu
+    void publish_load() {
+        int active_rooms = 0;
+        int players = 0;
+        int spectators = 0;
+        int open_quick_seats = 0;
+        int quick_rooms = 0;
+        int watchable_quick_rooms = 0;
+        for (const auto& room : rooms) {
+            if (!room->in_use) continue;
+            active_rooms++;
+            spectators += (int)room->spectators.size();
+            int connected = 0;
+            for (const auto& player : room->players) {
+                if (player.connected) connected++;
+            }
+            players += connected;
+            if (!room->name.empty()) continue;
+            
+            quick_rooms++;
+            if (world.is_running(room->slot)) {
+                watchable_quick_rooms++;
+            } else {
+                open_quick_seats += 4 - connected;
+            }
+        }
+        
+        load.rooms_active.store(active_rooms, std::memory_order_relaxed);
+        load.players.store(players, std::memory_order_relaxed);
+        load.spectators.store(spectators, std::memory_order_relaxed);
+        load.open_quick_seats.store(open_quick_seats, std::memory_order_relaxed);
+        load.quick_rooms.store(quick_rooms, std::memory_order_relaxed);
+        load.watchable_quick_rooms.store(watchable_quick_rooms, std::memory_order_relaxed);
+        load.adopted.store(adopted_count, std::memory_order_release);
+        load_changed = false;
+    }
+    
+    void handle_tcp_event(int fd, uint32_t events) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = *it->second;
+        load_changed = true;
+        
+        if (events & EPOLLOUT) {
+            queue_flush(conn);
+        }
+        if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) return;
+        
+        // Odczyt porcjami wielkości bufora połączenia, z przetworzeniem kompletnych ramek po każdej
+        while (true) {
+            FrameIo result = conn.reader.fill(fd);
+            if (result == FRAME_IO_CLOSED) {
+                // Klient zamknął połączenie (lub błąd) bez PLAYER_LEAVE
+                close_connection(conn);
+                return;
+            }
+            if (!process_messages(conn)) return;
+            if (result == FRAME_IO_AGAIN) return;
+        }
+    }
+    
+    // Przetwarza wszystkie kompletne ramki z bufora połączenia; false, jeśli połączenie zostało zamknięte
+    bool process_messages(Connection& conn) {
+        Frame frame;
+        while (conn.reader.next(frame)) {
+            if (!handle_message(conn, frame)) return false;
+        }
+        
+        // Ramka dłuższa niż dopuszcza protokół - strumień nie do odczytania
+        if (conn.reader.is_broken()) {
+            close_connection(conn);
+            return false;
+        }
+        return true;
+    }
+    
+    // Koduje komunikat według schematu (wire.h) i dopisuje go do kolejki połączenia
+    template <typename P>
+    void send_packet(int fd, const P& packet) {
+        uint8_t buffer[WIRE_MAX_SIZE<P>];
+        send_frame(fd, WireSchema<P>::type, buffer, wire_encode(packet, buffer));
+    }
+    
+    // Dopisuje komunikat do kolejki połączenia; wysyłka po zakończeniu serii zdarzeń
+    void send_frame(int fd, uint8_t type, const void* payload = nullptr, size_t length = 0) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = *it->second;
+        
+        // Przepełnienie (odbiorca nie odbiera) kończy połączenie w flush_connections,
+        // nie tutaj - nadawca może być w trakcie obsługi innego połączenia tego pokoju
+        conn.writer.queue(type, payload, length);
+        metrics.tcp_frames_sent.add();
+        queue_flush(conn);
+    }
+    
+    void queue_flush(Connection& conn) {
+        if (conn.flush_queued) return;
+        conn.flush_queued = true;
+        pending_output.push_back(conn.socket);
+    }
+    
+    // Wysyła zaległe komunikaty bez blokowania. Czego gniazdo nie przyjmie, czeka
+    // w buforze połączenia na EPOLLOUT; zapełniony bufor zrywa połączenie.
+    void flush_connections() {
+        // Zamknięcie połączenia może dopisać komunikaty dla pozostałych graczy pokoju
+        for (size_t i = 0; i < pending_output.size(); i++) {
+            auto it = connections.find(pending_output[i]);
+            if (it == connections.end()) continue;
+            Connection& conn = *it->second;
+            conn.flush_queued = false;
+            
+            if (conn.writer.has_overflowed()) {
+                LOG_WARN("Klient " << inet_ntoa(conn.addr.sin_addr) << " nie odbiera komunikatów - rozłączanie");
+                metrics.tcp_slow_closed.add();
+                close_connection(conn);
+                continue;
+            }
+            
+            FrameIo result = FRAME_IO_OK;
+            if (conn.writer.pending()) {
+                metrics.tcp_send_syscalls.add();
+                result = conn.writer.flush(conn.socket);
+            }
+            if (result == FRAME_IO_CLOSED) {
+                close_connection(conn);
+                continue;
+            }
+            set_output_interest(conn, result == FRAME_IO_AGAIN);
+        }
+        pending_output.clear();
+    }
+    
+    void set_output_interest(Connection& conn, bool enabled) {
+        if (conn.want_output == enabled) return;
+        conn.want_output = enabled;
+        epoll_event event{};
+        event.events = enabled ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.fd = conn.socket;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.socket, &event);
+    }
+    
+    // Zwraca false, jeśli połączenie zostało zamknięte. Komunikat, którego nie da się
+    // zdekodować według schematu, jest traktowany jak nieoczekiwany.
+    bool handle_message(Connection& conn, const Frame& frame) {
+        uint8_t packet_type = frame.type;
+        switch (conn.stage) {
+            case STAGE_HELLO:
+                // Wersję uzgadnia wątek przyjmujący przed przekazaniem połączenia
+                break;
+            case STAGE_SELECT_ROOM:
+                if (packet_type == PACKET_CREATE_JOIN_SERVER) {
+                    CreateJoinServerPacket packet;
+                    if (wire_decode(frame.payload, frame.length, packet)) return handle_create_join(conn, &packet);
+                }
+                if (packet_type == PACKET_JOIN_LOBBY) {
+                    JoinLobbyPacket packet;
+                    if (!wire_decode(frame.payload, frame.length, packet)) break;
+                    // Bez wyboru pokoju - szybka gra
+                    conn.player_id = reserve_slot("", conn.room);
+                    if (conn.player_id < 0) {
+                        close_connection(conn);
+                        return false;
+                    }
+                    return handle_player_join(conn, &packet);
+                }
+                if (packet_type == PACKET_SPECTATE) {
+                    SpectatePacket packet;
+                    if (wire_decode(frame.payload, frame.length, packet)) return handle_spectate(conn, &packet);
+                }
+                break;
+            case STAGE_JOIN_LOBBY:
+                if (packet_type == PACKET_JOIN_LOBBY) {
+                    JoinLobbyPacket packet;
+                    if (wire_decode(frame.payload, frame.length, packet)) return handle_player_join(conn, &packet);
+                }
+                break;
+            case STAGE_IN_ROOM:
+                if (packet_type == PACKET_PLAYER_READY) {
+                    handle_player_ready(*conn.room, conn.player_id);
+                    return true;
+                }
+                if (packet_type == PACKET_PLAYER_LEAVE) {
+                    close_connection(conn);
+                    return false;
+                }
+                break;
+            case STAGE_SPECTATING:
+                if (packet_type == PACKET_PLAYER_LEAVE) {
+                    close_connection(conn);
+                    return false;
+                }
+                break;
+        }
+        
+        // Komunikat nieoczekiwany na tym etapie
+        close_connection(conn);
+        return false;
+    }
+    
+    bool handle_create_join(Connection& conn, const CreateJoinServerPacket* create_packet) {
+        int name_length = std::max(0, std::min<int>(create_packet->server_name_length,
+                                                     sizeof(create_packet->server_name) - 1));
+        std::string room_name(create_packet->server_name, name_length);
+        
+        conn.player_id = reserve_slot(room_name, conn.room);
+        
+        ServerResponsePacket response;
+        response.port = conn.player_id >= 0 ? port : -1;
+        send_packet(conn.socket, response);
+        
+        if (conn.player_id < 0) {
+            close_connection(conn);
+            return false;
+        }
+        
+        conn.stage = STAGE_JOIN_LOBBY;
+        return true;
+    }
+    
+    // Rezerwuje miejsce w pokoju o podanej nazwie (tworząc go w razie potrzeby).
+    // Pusta nazwa dołącza do dowolnego pokoju z szybkiej gry, który ma wolne miejsce.
+    // Zwraca id gracza lub -1, gdy pokój jest pełny, gra już trwa albo brak wolnych pokoi.
+    int reserve_slot(const std::string& room_name, Room*& room) {
+        room = nullptr;
+        for (auto& candidate : rooms) {
+            if (!candidate->in_use || candidate->name != room_name) continue;
+            
+            bool joinable = !world.is_running(candidate->slot) && candidate->free_slot() >= 0;
+            if (joinable) {
+                room = candidate.get();
+                break;
+            }
+            if (!room_name.empty()) return -1;
+        }
+        
+        if (!room) {
+            for (auto& candidate : rooms) {
+                if (!candidate->in_use) {
+                    room = candidate.get();
+                    room->in_use = true;
+                    room->name = room_name;
+                    LOG_INFO("Utworzono pokój " << room->id << " (" << room_name << ")");
+                    break;
+                }
+            }
+        }
+        
+        if (!room) return -1;
+        
+        int player_id = room->free_slot();
+        room->players[player_id].connected = true;
+        return player_id;
+    }
+    
+    void release_slot(Room& room, int player_id) {
+        sessions.erase(room.players[player_id].session_token);
+        room.players[player_id] = PlayerConnection();
+        room.rtt_gauge[player_id].store(0.0f, std::memory_order_relaxed);
+        if (room.empty()) {
+            LOG_INFO("Zamknięto pokój " << room.id);
+            detach_spectators(room);
+            if (room.replay.is_open()) {
+                GameState state;
+                world.store(room.slot, state);
+                room.replay.finish(REPLAY_ABORT, room.match_tick, state);
+            }
+            room.reset();
+            world.reset(room.slot);
+        }
+    }
+    
+    // Pokój do oglądania: po nazwie, a dla pustej nazwy pokój z szybkiej gry
+    // (najlepiej z trwającą grą)
+    Room* find_room_to_watch(const std::string& room_name) {
+        Room* found = nullptr;
+        for (auto& candidate : rooms) {
+            if (!candidate->in_use || candidate->name != room_name) continue;
+            if (world.is_running(candidate->slot)) return candidate.get();
+            if (!found) found = candidate.get();
+        }
+        return found;
+    }
+    
+    bool handle_spectate(Connection& conn, const SpectatePacket* packet) {
+        int name_length = std::max(0, std::min<int>(packet->server_name_length, sizeof(packet->server_name) - 1));
+        std::string room_name(packet->server_name, name_length);
+        Room* room = find_room_to_watch(room_name);
+        
+        SpectateAcceptedPacket response{};
+        response.tick_rate = tick_rate;
+        
+        if (!room) {
+            send_packet(conn.socket, response);
+            close_connection(conn);
+            return false;
+        }
+        
+        // Rzadsze migawki to co n-ta migawka pokoju, opóźnienie - przesunięcie w pierścieniu
+        int sync_hz = tick_rate / sync_interval_ticks;
+        Spectator spectator{};
+        spectator.tcp_socket = conn.socket;
+        spectator.session_token = new_session_token();
+        spectator.rate_divisor = packet->sync_rate > 0 ? std::max(1, sync_hz / (int)packet->sync_rate) : 1;
+        int delay_ms = std::max(0, std::min<int>(packet->delay_ms, MAX_SPECTATOR_DELAY_MS));
+        spectator.delay_frames = std::min((delay_ms * sync_hz + 500) / 1000, spectator_history - 1);
+        
+        if (room->spectator_frames.empty()) {
+            room->spectator_frames.resize(spectator_history);
+        }
+        room->spectator_feed = true;
+        room->spectators.push_back(spectator);
+        sessions[spectator.session_token] = SessionRef{room, SPECTATOR_ID};
+        conn.room = room;
+        conn.stage = STAGE_SPECTATING;
+        
+        response.sync_interval_ms = 1000 * spectator.rate_divisor / sync_hz;
+        response.delay_ms = 1000 * spectator.delay_frames / sync_hz;
+        response.session_token = spectator.session_token;
+        send_packet(conn.socket, response);
+        
+        // Gra już trwa - widz zaczyna oglądać od razu
+        if (world.is_running(room->slot)) {
+            send_frame(conn.socket, PACKET_GAME_START);
+        }
+        
+        LOG_INFO("Widz dołączył do pokoju " << room->id << " (migawka co " << response.sync_interval_ms
+                 << " ms, opóźnienie " << response.delay_ms << " ms, widzów: " << room->spectators.size() << ")");
+        return true;
+    }
+    
+    void remove_spectator(Room& room, int tcp_socket) {
+        for (size_t i = 0; i < room.spectators.size(); i++) {
+            if (room.spectators[i].tcp_socket != tcp_socket) continue;
+            sessions.erase(room.spectators[i].session_token);
+            room.spectators[i] = room.spectators.back();
+            room.spectators.pop_back();
+            LOG_INFO("Widz opuścił pokój " << room.id);
+            return;
+        }
+    }
+    
+    // Zamykany pokój rozłącza widzów: ich połączenia wracają do wyboru pokoju,
+    // a shutdown kończy je przy najbliższym odczycie (bez zamykania w trakcie obsługi innego)
+    void detach_spectators(Room& room) {
+        for (const Spectator& spectator : room.spectators) {
+            sessions.erase(spectator.session_token);
+            auto it = connections.find(spectator.tcp_socket);
+            if (it != connections.end()) {
+                it->second->stage = STAGE_SELECT_ROOM;
+                it->second->room = nullptr;
+            }
+            shutdown(spectator.tcp_socket, SHUT_RDWR);
+        }
+        room.spectators.clear();
+    }
+    
+    bool handle_player_join(Connection& conn, const JoinLobbyPacket* join_packet) {
+        Room& room = *conn.room;
+        int player_id = conn.player_id;
+        
+        char nick[sizeof(join_packet->nick)];
+        memcpy(nick, join_packet->nick, sizeof(nick));
+        nick[sizeof(nick) - 1] = '\0';
+        int nick_length = std::max(0, std::min<int>(join_packet->nick_length, strlen(nick)));
+        
+        // Ustaw gracza
+        PlayerConnection& player = room.players[player_id];
+        player.tcp_socket = conn.socket;
+        player.udp_socket = udp_socket;
+        player.session_token = new_session_token();
+        sessions[player.session_token] = SessionRef{&room, player_id};
+        memcpy(player.nick, nick, nick_length);
+        player.nick[nick_length] = '\0';
+        conn.stage = STAGE_IN_ROOM;
+        
+        // Wyślij potwierdzenie
+        PlayerJoinedPacket response;
+        response.player_id = player_id;
+        response.nick_length = nick_length;
+        strcpy(response.nick, nick);
+        response.tick_rate = tick_rate;
+        response.session_token = player.session_token;
+        send_packet(conn.socket, response);
+        
+        LOG_INFO("Gracz " << player_id << " (" << player.nick << ") dołączył do pokoju " << room.id);
+        return true;
+    }
+    
+    // Losowy, niezerowy i nieużywany token sesji. Najstarszy bajt to numer shardu -
+    // po nim jądro kieruje datagramy gracza do gniazda tego shardu (steer_datagrams).
+    uint64_t new_session_token() {
+        uint64_t token;
+        do {
+            token = (token_rng() >> 8) | ((uint64_t)index << TOKEN_SHARD_SHIFT);
+        } while (token == 0 || sessions.count(token));
+        return token;
+    }
+    
+    void handle_player_ready(Room& room, int player_id) {
+        auto& players = room.players;
+        players[player_id].ready = true;
+        
+        // Powiadom innych graczy
+        ReadyPropagationPacket packet;
+        packet.player_id = player_id;
+        
+        for (int i = 0; i < 4; i++) {
+            if (i != player_id && players[i].connected && players[i].tcp_socket >= 0) {
+                send_packet(players[i].tcp_socket, packet);
+            }
+        }
+        
+        // Sprawdź czy wszyscy gotowi
+        bool all_ready = true;
+        int connected_players = 0;
+        for (int i = 0; i < 4; i++) {
+            if (players[i].connected) {
+                connected_players++;
+                if (!players[i].ready) {
+                    all_ready = false;
+                }
+            }
+        }
+        
+        if (all_ready && connected_players == 4) {
+            start_game(room);
+        }
+    }
+    
+    void start_game(Room& room) {
+        // Kierunki kulki po resecie zależą tylko od ziarna pokoju - razem
+        // z akcjami graczy wystarcza do odtworzenia meczu
+        uint64_t seed = token_rng();
+        world.seed(room.slot, seed);
+        world.start(room.slot);
+        // Akcje z końcówki poprzedniego meczu nie przechodzą do nowego
+        room.action_queue.clear();
+        room.match_tick = 0;
+        room.match_start = std::chrono::steady_clock::now();
+        if (!replay_dir.empty()) {
+            start_replay(room, seed);
+        }
+        
+        // Powiadom graczy i widzów o rozpoczęciu gry
+        for (int i = 0; i < 4; i++) {
+            if (room.players[i].connected) {
+                send_frame(room.players[i].tcp_socket, PACKET_GAME_START);
+            }
+        }
+        for (const Spectator& spectator : room.spectators) {
+            send_frame(spectator.tcp_socket, PACKET_GAME_START);
+        }
+        
+        unpark();
+        LOG_INFO("Gra rozpoczęta w pokoju " << room.id << "!");
+    }
+    
+    void start_replay(Room& room, uint64_t seed) {
+        time_t now = time(nullptr);
+        tm local{};
+        localtime_r(&now, &local);
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+        char seed_hex[17];
+        snprintf(seed_hex, sizeof(seed_hex), "%016llx", (unsigned long long)seed);
+        std::string path = replay_dir + "/room" + std::to_string(room.id) + "-" + stamp + "-" + seed_hex + ".t4r";
+        
+        GameState state;
+        world.store(room.slot, state);
+        ReplayHeader header{};
+        memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+        header.version = REPLAY_VERSION;
+        header.tick_rate = tick_rate;
+        header.room_id = room.id;
+        header.start_time_ms = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        replay_header_from_state(header, state);
+        
+        if (room.replay.open(path, header)) {
+            LOG_INFO("Zapis powtórki pokoju " << room.id << ": " << path);
+        } else {
+            LOG_WARN("Nie można utworzyć pliku powtórki " << path << ": " << strerror(errno));
+        }
+    }
+    
+    void handle_player_leave(Room& room, int player_id) {
+        auto& players = room.players;
+        players[player_id].tcp_socket = -1;
+        players[player_id].ready = false;
+        
+        // Powiadom innych graczy
+        PlayerLeftPacket packet;
+        packet.player_id = player_id;
+        
+        for (int i = 0; i < 4; i++) {
+            if (i != player_id && players[i].connected && players[i].tcp_socket >= 0) {
+                send_packet(players[i].tcp_socket, packet);
+            }
+        }
+        
+        LOG_INFO("Gracz " << player_id << " opuścił pokój " << room.id);
+        release_slot(room, player_id);
+    }
+    
+    // Zamyka połączenie TCP i zwalnia miejsce gracza w pokoju
+    void close_connection(Connection& conn) {
+        int fd = conn.socket;
+        
+        if (conn.stage == STAGE_IN_ROOM) {
+            handle_player_leave(*conn.room, conn.player_id);
+        } else if (conn.stage == STAGE_JOIN_LOBBY) {
+            release_slot(*conn.room, conn.player_id);
+        } else if (conn.stage == STAGE_SPECTATING) {
+            remove_spectator(*conn.room, fd);
+        }
+        
+        // Ostatnie komunikaty (np. odmowa miejsca w pokoju), jeśli gniazdo je przyjmie
+        if (!conn.writer.has_overflowed()) {
+            conn.writer.flush(fd);
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        
+        // Obiekt wraca z buforami do puli wątku przyjmującego. Trasa jest zwalniana
+        // tutaj - jej licznik referencji mówi wątkowi przyjmującemu, czy pokój żyje.
+        auto it = connections.find(fd);
+        Connection* closed = it->second.release();
+        connections.erase(it);
+        closed->route.reset();
+        if (!recycled.push(closed)) {
+            delete closed;
+        }
+        load.connections.fetch_sub(1, std::memory_order_relaxed);
+        load_changed = true;
+    }
+    
+    void handle_udp_messages() {
+        // Odbieraj wsadami, aż gniazdo będzie puste; odpowiedzi i propagacje
+        // trafiają do udp_out i wychodzą jednym sendmmsg na końcu
+        int received;
+        while ((received = udp_in.receive()) > 0) {
+            for (int i = 0; i < received; i++) {
+                handle_udp_datagram(udp_in.data(i), udp_in.length(i), udp_in.addr(i));
+            }
+            if (received < UDP_BATCH_SIZE) break;
+        }
+        udp_out.flush();
+    }
+    
+    void handle_udp_datagram(const uint8_t* buffer, size_t bytes, const sockaddr_in& client_addr) {
+        if (bytes < 1) {
+            metrics.udp_malformed.add();
+            return;
+        }
+        
+        uint8_t packet_type = buffer[0];
+        const uint8_t* payload = buffer + 1;
+        size_t length = bytes - 1;
+        
+        // Każdy pakiet klienta niesie token sesji
+        UdpBindPacket bind;
+        PlayerActionPacket action;
+        SnapshotAckPacket ack;
+        bool valid = false;
+        uint64_t token = 0;
+        switch (packet_type) {
+            case PACKET_UDP_BIND:
+                valid = wire_decode(payload, length, bind);
+                token = bind.session_token;
+                break;
+            case PACKET_PLAYER_ACTION:
+                valid = wire_decode(payload, length, action);
+                token = action.session_token;
+                break;
+            case PACKET_SNAPSHOT_ACK:
+                valid = wire_decode(payload, length, ack);
+                token = ack.session_token;
+                break;
+        }
+        if (!valid) {
+            metrics.udp_malformed.add();
+            return;
+        }
+        
+        auto session = sessions.find(token);
+        if (session == sessions.end()) {
+            // Klient po końcu sesji albo zalew portu - ostrzeżenie co 100 datagramów,
+            // dokładna liczba jest w metryce
+            metrics.udp_unknown_token.add();
+            uint64_t unknown = metrics.udp_unknown_token.get();
+            if (unknown % 100 == 1) {
+                LOG_WARN("Nieznany token sesji w pakiecie UDP (łącznie " << unknown << ")");
+            }
+            return;
+        }
+        Room* room = session->second.room;
+        int player_id = session->second.player_id;
+        if (player_id == SPECTATOR_ID) {
+            handle_spectator_datagram(*room, token, packet_type, client_addr);
+            return;
+        }
+        
+        // Adres nadawcy poprawnego pakietu jest adresem UDP gracza (także po zmianie NAT)
+        PlayerConnection& player = room->players[player_id];
+        player.udp_addr = client_addr;
+        player.udp_bound = true;
+        
+        if (packet_type == PACKET_UDP_BIND) {
+            uint8_t ack = PACKET_UDP_BIND_ACK;
+            udp_out.send(&ack, 1, client_addr);
+            return;
+        }
+        
+        if (packet_type == PACKET_SNAPSHOT_ACK) {
+            handle_snapshot_ack(*room, player_id, &ack);
+            return;
+        }
+        
+        handle_player_action(*room, player_id, &action);
+    }
+    
+    // Widz wysyła tylko UDP_BIND (akcje i potwierdzenia są pomijane)
+    void handle_spectator_datagram(Room& room, uint64_t token, uint8_t packet_type, const sockaddr_in& client_addr) {
+        if (packet_type != PACKET_UDP_BIND) return;
+        
+        for (Spectator& spectator : room.spectators) {
+            if (spectator.session_token != token) continue;
+            spectator.udp_addr = client_addr;
+            spectator.udp_bound = true;
+            uint8_t ack = PACKET_UDP_BIND_ACK;
+            udp_out.send(&ack, 1, client_addr);
+            return;
+        }
+    }
+    
+    // Pakiet akcji niesie najnowsze wejście i kilka poprzednich (redundancja).
+    // Do kolejki trafiają tylko wejścia nowsze niż już odebrane, w kolejności numerów,
+    // więc duplikaty i przestawione datagramy nie są stosowane ponownie.
+    void handle_player_action(Room& room, int player_id, const PlayerActionPacket* packet) {
+        // Pokój bez meczu nie ma taktu, który opróżniłby kolejkę
+        if (!world.is_running(room.slot)) return;
+        
+        PlayerConnection& player = room.players[player_id];
+        int count = std::max(1, std::min(INPUT_REDUNDANCY, (int)packet->count));
+        auto now = std::chrono::steady_clock::now();
+        
+        for (int i = count - 1; i >= 0; i--) {
+            uint32_t seq = packet->input_seq - i;
+            if (seq == 0) continue;
+            if (player.received_seq != 0 && (int32_t)(seq - player.received_seq) <= 0) continue;
+            
+            int action = packet->actions[i];
+            if (action < ACTION_MOVE_LEFT || action > ACTION_STOP) continue;
+            
+            // Dodaj akcję do kolejki
+            ActionEvent event;
+            event.player_id = player_id;
+            event.action = (PlayerAction)action;
+            event.input_seq = seq;
+            event.timestamp = now;
+            
+            // Pełna kolejka: akcja jest odrzucana, a received_seq nie rośnie, więc
+            // klient dośle ją ponownie (redundancja i ponawianie niepotwierdzonych wejść)
+            if (!room.action_queue.push(event)) {
+                metrics.actions_dropped.add();
+                if (room.dropped_actions++ % 100 == 0) {
+                    LOG_WARN("Pełna kolejka akcji w pokoju " << room.id << " - odrzucono "
+                             << room.dropped_actions << " akcji");
+                }
+                break;
+            }
+            player.received_seq = seq;
+            metrics.actions_received.add();
+            
+            // Propaguj akcję do innych graczy
+            propagate_action(room, player_id, event.action, seq);
+        }
+    }
+    
+    void handle_snapshot_ack(Room& room, int player_id, const SnapshotAckPacket* packet) {
+        PlayerConnection& player = room.players[player_id];
+        uint16_t seq = (uint16_t)packet->snapshot_seq;
+        // Potwierdzenia mogą przyjść w innej kolejności - bierzemy tylko nowsze
+        if (!player.snapshot_acked || seq_newer(seq, player.acked_snapshot)) {
+            player.acked_snapshot = seq;
+            player.snapshot_acked = true;
+            
+            // RTT tylko dla migawek, które są jeszcze w historii (znany czas wysłania)
+            if (room.snapshots.find(seq)) {
+                auto rtt = std::chrono::steady_clock::now() - room.snapshot_sent[seq % SNAPSHOT_HISTORY];
+                metrics.rtt.record(rtt);
+                float sample = std::chrono::duration<float>(rtt).count();
+                player.rtt = player.rtt > 0.0f ? player.rtt + (sample - player.rtt) * RTT_SMOOTHING : sample;
+                room.rtt_gauge[player_id].store(player.rtt, std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    void propagate_action(Room& room, int player_id, PlayerAction action, uint32_t input_seq) {
+        ActionPropagationPacket packet;
+        packet.player_id = player_id;
+        packet.action = action;
+        packet.input_seq = input_seq;
+        uint8_t buffer[1 + WIRE_MAX_SIZE<ActionPropagationPacket>];
+        size_t length = wire_encode_datagram(packet, buffer);
+        
+        for (int i = 0; i < 4; i++) {
+            if (i != player_id && room.players[i].connected && room.players[i].udp_bound) {
+                udp_out.send(buffer, length, room.players[i].udp_addr);
+            }
+        }
+    }
+    
+    // Jeden takt gry o stałym kroku dla pokoi z trwającymi meczami (wywoływany przez
+    // tick_timer). Pokoje są przetwarzane blokami slotów, które mogą podebrać inne
+    // shardy; pokoje bez meczu (lobby, po końcu gry) nie dostają żadnej pracy, a shard
+    // bez ani jednego meczu zatrzymuje timer do startu gry.
+    void game_loop() {
+        int active_blocks = 0;
+        for (int block = 0; block < TICK_BLOCKS; block++) {
+            if (block_active(block)) active_blocks++;
+        }
+        if (active_blocks == 0) {
+            park();
+            return;
+        }
+        
+        tick_start = std::chrono::steady_clock::now();
+        tick_count++;
+        metrics.ticks.add();
+        sync_due = tick_count % sync_interval_ticks == 0;
+        
+        // Publikacja taktu - kto pobierze blok, widzi też parametry taktu zapisane wyżej
+        tasks.done.store(0, std::memory_order_relaxed);
+        tasks.state.store(++tick_generation << 32, std::memory_order_release);
+        if (active_blocks > 1 && last_tick_nanos > HELP_TICK_NANOS) {
+            wake_parked_peers(active_blocks - 1);
+        }
+        
+        uint64_t allocations = heap_allocations();
+        int block;
+        while ((block = claim_block()) >= 0) {
+            run_block(block, udp_out);
+            tasks.done.fetch_add(1, std::memory_order_release);
+        }
+        
+        // Migawki pokoi przetworzonych w tym wątku wychodzą wsadami (sendmmsg)
+        udp_out.flush();
+        metrics.tick_allocations.add(heap_allocations() - allocations);
+        
+        // Bloki podebrane przez inne shardy (każdy złodziej liczy najwyżej jeden naraz)
+        while (tasks.done.load(std::memory_order_acquire) < TICK_BLOCKS) {
+            std::this_thread::yield();
+        }
+        
+        auto tick_end = std::chrono::steady_clock::now();
+        if (sync_due) {
+            metrics.sync_fanout.record(tick_end - tick_start);
+            if (last_sync.time_since_epoch().count() != 0) {
+                metrics.sync_interval.record(tick_start - last_sync);
+            }
+            last_sync = tick_start;
+        }
+        metrics.tick_time.record(tick_end - tick_start);
+        last_tick_nanos = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(tick_end - tick_start).count();
+    }
+    
+    bool block_active(int block) const {
+        int begin = block * TICK_BLOCK_SLOTS;
+        for (int slot = begin; slot < begin + TICK_BLOCK_SLOTS; slot++) {
+            if (world.is_running(slot)) return true;
+        }
+        return false;
+    }
+    
+    // Pobiera kolejny blok bieżącego taktu; -1, gdy wszystkie są już pobrane
+    int claim_block() {
+        uint64_t state = tasks.state.load(std::memory_order_acquire);
+        while ((uint32_t)state < TICK_BLOCKS) {
+            if (tasks.state.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+                return (int)(uint32_t)state;
+            }
+        }
+        return -1;
+    }
+    
+    // Takt pokoi jednego bloku - wykonywany przez właściciela albo złodzieja; out to
+    // kolejka wysyłki wykonującego wątku (gniazda shardów mają ten sam port, więc
+    // klient nie widzi różnicy)
+    void run_block(int block, UdpTxBatch& out) {
+        if (!block_active(block)) return;
+        int begin = block * TICK_BLOCK_SLOTS;
+        int end = begin + TICK_BLOCK_SLOTS;
+        metrics.tick_blocks.add();
+        
+        // Przetwórz akcje z kolejek przed krokiem symulacji
+        for (int slot = begin; slot < end; slot++) {
+            if (world.is_running(slot)) {
+                apply_actions(*rooms[slot]);
+            }
+        }
+        
+        // Jeden przebieg SoA przez pokoje bloku
+        world.step(tick_dt, begin, end);
+        
+        for (int slot = begin; slot < end; slot++) {
+            Room& room = *rooms[slot];
+            if (room.replay.is_open()) {
+                finish_replay_tick(room);
+            }
+            if (room.in_use && world.is_running(slot)) {
+                update_room(room, sync_due, out);
+            }
+        }
+    }
+        
+    // Podbiera bloki taktów innych shardów. Migawki widzów są wysyłane bez kopiowania,
+    // więc kolejka wysyłki jest opróżniana przed oddaniem bloku.
+    void help_peers() {
+        for (RoomShard* peer : peers) {
+            if (peer == this) continue;
+            int block;
+            while ((block = peer->claim_block()) >= 0) {
+                uint64_t allocations = heap_allocations();
+                peer->run_block(block, udp_out);
+                udp_out.flush();
+                peer->metrics.tick_allocations.add(heap_allocations() - allocations);
+                peer->metrics.tick_blocks_stolen.add();
+                peer->tasks.done.fetch_add(1, std::memory_order_release);
+            }
+        }
+    }
+        
+    void wake_parked_peers(int helpers) {
+        for (RoomShard* peer : peers) {
+            if (helpers == 0) return;
+            if (peer == this || !peer->load.parked.load(std::memory_order_relaxed)) continue;
+            peer->wake();
+            helpers--;
+        }
+    }
+        
+    // Bez trwających meczów takt nie ma nic do zrobienia - timer stoi do start_game
+    void park() {
+        itimerspec stopped{};
+        timerfd_settime(tick_timer, 0, &stopped, nullptr);
+        load.parked.store(true, std::memory_order_relaxed);
+        // Przerwa w taktach to nie odstęp między migawkami
+        last_sync = std::chrono::steady_clock::time_point();
+    }
+    
+    // Okresowy timerfd odmierza bezwzględne terminy, więc takt nie dryfuje
+    void unpark() {
+        if (!load.parked.load(std::memory_order_relaxed)) return;
+        itimerspec tick_spec{};
+        tick_spec.it_interval.tv_nsec = 1000000000L / tick_rate;
+        tick_spec.it_value = tick_spec.it_interval;
+        timerfd_settime(tick_timer, 0, &tick_spec, nullptr);
+        load.parked.store(false, std::memory_order_relaxed);
+    }
+    
+    void apply_actions(Room& room) {
+        // Bloki pokoi shardu mogą liczyć równolegle różne wątki
+        uint64_t depth = room.action_queue.size();
+        uint64_t peak = metrics.queue_depth_peak.load(std::memory_order_relaxed);
+        while (depth > peak &&
+               !metrics.queue_depth_peak.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {}
+        
+        ActionEvent event;
+        while (room.action_queue.pop(event)) {
+            // Wejście starsze niż już zastosowane (przestawione przez sieć) jest pomijane
+            PlayerConnection& player = room.players[event.player_id];
+            if (player.input_seq != 0 && (int32_t)(event.input_seq - player.input_seq) <= 0) continue;
+            
+            if (world.is_running(room.slot)) {
+                player.input_seq = event.input_seq;
+                player.input_tick = tick_count;
+                metrics.action_latency.record(tick_start - event.timestamp);
+                
+                // POPRAWKA: Dodaj logowanie akcji
+                LOG_DEBUG("Przetwarzanie akcji gracza " << event.player_id
+                          << " w pokoju " << room.id << ": " << (int)event.action);
+                world.set_action(room.slot, event.player_id, event.action);
+                if (room.replay.is_open()) {
+                    auto received = std::chrono::duration_cast<std::chrono::microseconds>(event.timestamp - room.match_start);
+                    room.replay.action(room.match_tick, (uint32_t)std::max<int64_t>(0, received.count()),
+                                       event.player_id, event.action);
+                }
+            }
+        }
+    }
+    
+    // Po kroku symulacji: licznik kroków meczu i zamknięcie powtórki po końcu gry
+    void finish_replay_tick(Room& room) {
+        room.match_tick++;
+        if (!world.is_running(room.slot)) {
+            GameState state;
+            world.store(room.slot, state);
+            room.replay.finish(REPLAY_END, room.match_tick, state);
+            LOG_INFO("Zapisano powtórkę pokoju " << room.id << " (" << room.match_tick << " taktów)");
+        }
+    }
+    
+    void update_room(Room& room, bool sync_due, UdpTxBatch& out) {
+        // POPRAWKA: Loguj pozycję kulki co jakiś czas
+        if (++room.log_counter % tick_rate == 0) { // co sekundę
+            LOG_DEBUG("Pokój " << room.id << " - Ball position: x=" << world.ball_x[room.slot]
+                      << ", y=" << world.ball_y[room.slot]);
+        }
+        
+        if (sync_due) {
+            sync_game_state(room, out);
+        }
+    }
+    
+    void sync_game_state(Room& room, UdpTxBatch& out) {
+    int slot = room.slot;
+    if (!world.is_running(slot)) return;
+    
+    Snapshot snapshot;
+    snapshot.seq = ++room.snapshot_seq;
+    snapshot.tick = (uint16_t)tick_count;
+    snapshot.fields[FIELD_BALL_X] = quantize(world.ball_x[slot]);
+    snapshot.fields[FIELD_BALL_Y] = quantize(world.ball_y[slot]);
+    snapshot.fields[FIELD_BALL_VX] = quantize(world.ball_vx[slot]);
+    snapshot.fields[FIELD_BALL_VY] = quantize(world.ball_vy[slot]);
+    
+    for (int i = 0; i < 4; i++) {
+        snapshot.fields[FIELD_PADDLE_0 + i] = quantize(world.paddle_pos[i][slot]);
+        snapshot.scores[i] = world.scores[i][slot];
+    }
+    
+    int sent_count = 0;
+    for (int i = 0; i < 4; i++) {
+        const PlayerConnection& player = room.players[i];
+        if (player.connected && player.udp_bound) {
+            // Różnica względem ostatniej potwierdzonej migawki; pełna migawka, gdy
+            // klient nic jeszcze nie potwierdził albo baza wypadła z historii
+            const Snapshot* baseline = nullptr;
+            if (player.snapshot_acked) {
+                baseline = room.snapshots.find(player.acked_snapshot);
+            }
+            SnapshotInput input;
+            input.input_seq = (uint16_t)player.input_seq;
+            input.input_age = (uint8_t)std::min<uint64_t>(tick_count - player.input_tick, 255);
+            // Kodowanie wprost do bufora kolejki wysyłki - wysyłka wsadowa razem
+            // z pozostałymi pokojami na końcu taktu
+            uint8_t* buffer = out.reserve();
+            buffer[0] = PACKET_GAME_SYNC;
+            size_t length = 1 + encode_snapshot(snapshot, baseline, input, buffer + 1);
+            out.commit(length, player.udp_addr);
+            sent_count++;
+            metrics.snapshot_bytes.add(length);
+        }
+    }
+    
+    room.snapshots.put(snapshot);
+    room.snapshot_sent[snapshot.seq % SNAPSHOT_HISTORY] = std::chrono::steady_clock::now();
+    metrics.snapshots_sent.add(sent_count);
+    
+    if (room.spectator_feed) {
+        broadcast_to_spectators(room, snapshot, out);
+    }
+    
+    if (sent_count > 0) {
+        LOG_DEBUG("Wysłano sync do " << sent_count << " graczy w pokoju " << room.id);
+    }
+}
 
-struct PlayerConnection {
-    int tcp_socket;
-    int udp_socket;
-    sockaddr_in udp_addr;
-    std::string nick;
-    bool connected;
-    bool ready;
+// Migawka widzów jest kodowana raz na pokój (pełna - widzowie nic nie potwierdzają)
+// do pierścienia spectator_frames, a każdy widz dostaje wskaźnik na gotowy bufor:
+// opóźniony o delay_frames i co rate_divisor migawek. Kolejny widz to tylko wpis
+// w kolejce sendmmsg, bez kodowania i kopiowania; bufory w pierścieniu nie zmieniają
+// się do końca taktu, a blok podebrany przez inny shard opróżnia out przed oddaniem.
+void broadcast_to_spectators(Room& room, const Snapshot& snapshot, UdpTxBatch& out) {
+    uint32_t index = room.spectator_sync++;
+    SpectatorFrame& frame = room.spectator_frames[index % room.spectator_frames.size()];
+    frame.data[0] = PACKET_GAME_SYNC;
+    frame.length = 1 + encode_snapshot(snapshot, nullptr, SnapshotInput{}, frame.data + 1);
     
-    PlayerConnection() : tcp_socket(-1), udp_socket(-1), connected(false), ready(false) {}
+    int sent_count = 0;
+    for (const Spectator& spectator : room.spectators) {
+        if (!spectator.udp_bound || index < spectator.delay_frames) continue;
+        uint32_t shown = index - spectator.delay_frames;
+        if (shown % spectator.rate_divisor != 0) continue;
+        
+        const SpectatorFrame& delayed = room.spectator_frames[shown % room.spectator_frames.size()];
+        out.send_shared(delayed.data, delayed.length, spectator.udp_addr);
+        sent_count++;
+    }
+    metrics.spectator_snapshots.add(sent_count);
+}
 };
 
-struct ActionEvent {
-    int player_id;
-    PlayerAction action;
-    std::chrono::steady_clock::time_point timestamp;
-};
+// Program cBPF dla grupy SO_REUSEPORT gniazd UDP shardów: indeksem gniazda w grupie
+// (shardy dołączają do niej po kolei) jest najstarszy bajt tokenu sesji z datagramu,
+// więc datagram trafia prosto do wątku, który ma pokój nadawcy - bez przekazywania
+// między wątkami. Za krótki datagram daje 0 (shard 0 odrzuci go jako uszkodzony),
+// a numer spoza grupy - wybór gniazda po adresie nadawcy (nieznany token).
+bool steer_datagrams(int udp_socket) {
+    sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, DATAGRAM_SHARD_OFFSET),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    sock_fprog program{};
+    program.len = sizeof(code) / sizeof(code[0]);
+    program.filter = code;
+    return setsockopt(udp_socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) == 0;
+}
 
+// Wątek przyjmujący: nasłuchuje na porcie gry, uzgadnia wersję protokołu i po
+// pierwszym komunikacie wyboru pokoju przekazuje połączenie shardowi, który ma
+// (albo dostanie) ten pokój - nowe pokoje trafiają do najmniej obciążonego.
+// Obsługuje też punkt statystyk, sumując metryki wszystkich shardów.
 class GameServer {
 private:
-    GameState game_state;
-    std::array<PlayerConnection, 4> players;
-    std::mutex game_mutex;
-    std::queue<ActionEvent> action_queue;
-    std::mutex queue_mutex;
+    std::vector<std::unique_ptr<RoomShard>> shards;
+    std::vector<uint64_t> handed_off;  // połączenia przekazane każdemu shardowi (por. ShardLoad::adopted)
+    std::unordered_map<std::string, std::shared_ptr<RoomRoute>> routes;  // nazwa pokoju -> shard
+    size_t routes_prune_at;
+    int quick_shard;  // shard, do którego trafiają gracze szybkiej gry
+    int quick_seats;  // ilu jeszcze graczy szybkiej gry tam skierować
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;  // jeszcze bez shardu
+    ObjectPool<Connection> connection_pool;
+    std::unordered_set<int> stats_clients;  // połączenia z punktem statystyk
+    int port;
+    int stats_port;  // 0 = punkt statystyk wyłączony
+    std::string replay_dir;
     int server_socket;
-    int udp_socket;
+    int stats_socket;
+    int epoll_fd;
     bool running;
-    std::thread game_thread;
+    int tick_rate;
+    int worker_count;
+    bool pin_workers;
     
 public:
-    GameServer() : running(false), server_socket(-1), udp_socket(-1) {}
+    GameServer(int tick_rate, int workers, bool pin_workers)
+        : routes_prune_at(ROUTES_PRUNE_MIN), quick_shard(0), quick_seats(0), connection_pool(CONNECTION_POOL_CAPACITY), port(-1), stats_port(0),
+          server_socket(-1), stats_socket(-1), epoll_fd(-1), running(false), tick_rate(tick_rate),
+          worker_count(std::max(1, std::min(workers, MAX_SHARDS))), pin_workers(pin_workers) {}
     
     ~GameServer() {
         stop();
     }
     
-    bool start(int port) {
+    // Włącza zapis powtórek każdego meczu do plików w podanym katalogu
+    void record_replays(const std::string& dir) {
+        replay_dir = dir;
+    }
+    
+    bool start(int port, int stats_port) {
+        this->port = port;
+        this->stats_port = stats_port;
+        
         // Tworzenie TCP socket
-        server_socket = socket(AF_INET, SOCK_STREAM, 0);
+        server_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
         if (server_socket < 0) {
-            std::cerr << "Błąd tworzenia TCP socket\n";
-            return false;
-        }
-        
-        // Tworzenie UDP socket
-        udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
-        if (udp_socket < 0) {
-            std::cerr << "Błąd tworzenia UDP socket\n";
-            close(server_socket);
+            LOG_ERROR("Błąd tworzenia TCP socket");
             return false;
         }
         
@@ -72,381 +1713,608 @@ public:
         setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
         
         if (bind(server_socket, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-            std::cerr << "Błąd bind TCP socket\n";
-            close(server_socket);
-            close(udp_socket);
+            LOG_ERROR("Błąd bind TCP socket");
+            stop();
             return false;
         }
         
-        if (bind(udp_socket, (sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-            std::cerr << "Błąd bind UDP socket\n";
-            close(server_socket);
-            close(udp_socket);
+        if (listen(server_socket, SOMAXCONN) < 0) {
+            LOG_ERROR("Błąd listen");
+            stop();
+            return false;
+        }
+        
+        // Gniazda UDP shardów dołączają do grupy SO_REUSEPORT w kolejności numerów
+        for (int i = 0; i < worker_count; i++) {
+            shards.push_back(std::make_unique<RoomShard>(i, tick_rate, replay_dir));
+            if (!shards.back()->open(port)) {
+                stop();
+                return false;
+            }
+        }
+        
+        // Bez programu jądro rozdzielałoby datagramy po adresie nadawcy, a nie po pokoju
+        if (shards.size() > 1 && !steer_datagrams(shards[0]->udp_fd())) {
+            LOG_WARN("Nie można kierować datagramów do wątków roboczych (SO_ATTACH_REUSEPORT_CBPF: "
+                     << strerror(errno) << ") - serwer użyje jednego");
+            shards.resize(1);
+        }
+        handed_off.assign(shards.size(), 0);
+        
+        std::vector<RoomShard*> peers;
+        for (auto& shard : shards) {
+            peers.push_back(shard.get());
+        }
+        for (auto& shard : shards) {
+            shard->set_peers(peers);
+        }
+        
+        epoll_fd = epoll_create1(0);
+        if (epoll_fd < 0) {
+            LOG_ERROR("Błąd tworzenia epoll");
+            stop();
             return false;
         }
         
-        if (listen(server_socket, 4) < 0) {
-            std::cerr << "Błąd listen\n";
-            close(server_socket);
-            close(udp_socket);
+        watch(server_socket);
+        
+        if (stats_port > 0 && !start_stats()) {
+            stop();
             return false;
         }
         
         running = true;
-        game_thread = std::thread(&GameServer::game_loop, this);
         
-        std::cout << "Serwer uruchomiony na porcie " << port << std::endl;
+        LOG_INFO("Serwer uruchomiony na porcie " << port << " (" << tick_rate << " taktów/s, wątki robocze: "
+                 << shards.size() << ")");
+        if (stats_socket >= 0) {
+            LOG_INFO("Statystyki dostępne pod http://127.0.0.1:" << stats_port << "/metrics");
+        }
         return true;
     }
     
     void stop() {
         running = false;
-        if (game_thread.joinable()) {
-            game_thread.join();
+        
+        for (auto& shard : shards) {
+            shard->stop();
         }
+        shards.clear();
         
-        for (auto& player : players) {
-            if (player.tcp_socket >= 0) {
-                close(player.tcp_socket);
-            }
+        for (auto& entry : connections) {
+            close(entry.first);
         }
+        connections.clear();
+        
+        for (int fd : stats_clients) {
+            close(fd);
+        }
+        stats_clients.clear();
         
         if (server_socket >= 0) close(server_socket);
-        if (udp_socket >= 0) close(udp_socket);
+        if (stats_socket >= 0) close(stats_socket);
+        if (epoll_fd >= 0) close(epoll_fd);
+        server_socket = stats_socket = epoll_fd = -1;
     }
     
-    void accept_connections() {
+    // Uruchamia wątki robocze, a w bieżącym wątku pętlę przyjmowania połączeń
+    // i punktu statystyk
+    void run() {
+        int cpus = (int)std::thread::hardware_concurrency();
+        for (size_t i = 0; i < shards.size(); i++) {
+            shards[i]->start(pin_workers && cpus > 0 ? (int)i % cpus : -1);
+        }
+        
+        epoll_event events[MAX_EPOLL_EVENTS];
+        
         while (running) {
-            sockaddr_in client_addr;
-            socklen_t addr_len = sizeof(client_addr);
-            
-            int client_socket = accept(server_socket, (sockaddr*)&client_addr, &addr_len);
-            if (client_socket < 0) continue;
-            
-            // Znajdź wolne miejsce dla gracza
-            int player_id = -1;
-            for (int i = 0; i < 4; i++) {
-                if (!players[i].connected) {
-                    player_id = i;
-                    break;
-                }
+            int count = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                LOG_ERROR("Błąd epoll_wait: " << strerror(errno));
+                break;
             }
             
-            if (player_id == -1) {
-                close(client_socket);
-                continue;
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                
+                if (fd == server_socket) {
+                    accept_connections();
+                } else if (fd == stats_socket) {
+                    accept_stats_clients();
+                } else if (stats_clients.count(fd)) {
+                    serve_stats(fd);
+                } else {
+                    handle_tcp_event(fd);
+                }
             }
-            
-            // Obsłuż dołączenie gracza
-            handle_player_join(client_socket, player_id, client_addr);
         }
     }
-    
+
 private:
-    void handle_player_join(int socket, int player_id, sockaddr_in addr) {
-        // Odbierz nick gracza
-        uint8_t packet_type;
-        recv(socket, &packet_type, 1, 0);
-        
-        if (packet_type != PACKET_JOIN_LOBBY) {
-            close(socket);
-            return;
+    // Punkt statystyk nasłuchuje tylko na interfejsie lokalnym
+    bool start_stats() {
+        stats_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (stats_socket < 0) {
+            LOG_ERROR("Błąd tworzenia socket statystyk");
+            return false;
         }
         
-        JoinLobbyPacket join_packet;
-        recv(socket, &join_packet, sizeof(join_packet), 0);
-        
-        // Ustaw gracza
-        players[player_id].tcp_socket = socket;
-        players[player_id].udp_socket = udp_socket;
-        players[player_id].udp_addr = addr;
-        players[player_id].udp_addr.sin_port = htons(ntohs(addr.sin_port) + 1);
-        players[player_id].nick = std::string(join_packet.nick, join_packet.nick_length);
-        players[player_id].connected = true;
-        
-        // Wyślij potwierdzenie
-        uint8_t response_type = PACKET_PLAYER_JOINED;
-        send(socket, &response_type, 1, 0);
-        
-        PlayerJoinedPacket response;
-        response.player_id = player_id;
-        response.nick_length = join_packet.nick_length;
-        strcpy(response.nick, join_packet.nick);
+        int opt = 1;
+        setsockopt(stats_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
         
-        send(socket, &response, sizeof(response), 0);
+        sockaddr_in stats_addr{};
+        stats_addr.sin_family = AF_INET;
+        stats_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        stats_addr.sin_port = htons(stats_port);
         
-        // Uruchom wątek obsługi gracza
-        std::thread(&GameServer::handle_player, this, player_id).detach();
+        if (bind(stats_socket, (sockaddr*)&stats_addr, sizeof(stats_addr)) < 0 ||
+            listen(stats_socket, SOMAXCONN) < 0) {
+            LOG_ERROR("Błąd uruchamiania punktu statystyk na porcie " << stats_port << ": " << strerror(errno));
+            return false;
+        }
         
-        std::cout << "Gracz " << player_id << " (" << players[player_id].nick << ") dołączył\n";
+        watch(stats_socket);
+        return true;
     }
     
-    void handle_player(int player_id) {
-        int socket = players[player_id].tcp_socket;
-        
-        while (running && players[player_id].connected) {
-            uint8_t packet_type;
-            int bytes = recv(socket, &packet_type, 1, MSG_DONTWAIT);
+    void watch(int fd) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+    
+    void accept_connections() {
+        while (true) {
+            sockaddr_in client_addr;
+            socklen_t addr_len = sizeof(client_addr);
             
-            if (bytes <= 0) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
-            }
+            int client_socket = accept4(server_socket, (sockaddr*)&client_addr, &addr_len, SOCK_NONBLOCK);
+            if (client_socket < 0) return;
             
-            switch (packet_type) {
-                case PACKET_PLAYER_READY:
-                    handle_player_ready(player_id);
-                    break;
-                case PACKET_PLAYER_LEAVE:
-                    handle_player_leave(player_id);
-                    return;
-            }
+            // Komunikaty są łączone w kolejce połączenia - opóźnianie przez Nagle'a niczego nie da
+            int opt = 1;
+            setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+            connections[client_socket] = new_connection(client_socket, client_addr);
+            watch(client_socket);
         }
     }
     
-    void handle_player_ready(int player_id) {
-        players[player_id].ready = true;
-        
-        // Powiadom innych graczy
-        uint8_t packet_type = PACKET_READY_PROPAGATION;
-        ReadyPropagationPacket packet;
-        packet.player_id = player_id;
-        
-        for (int i = 0; i < 4; i++) {
-            if (i != player_id && players[i].connected) {
-                send(players[i].tcp_socket, &packet_type, 1, 0);
-                send(players[i].tcp_socket, &packet, sizeof(packet), 0);
-            }
-        }
-        
-        // Sprawdź czy wszyscy gotowi
-        bool all_ready = true;
-        int connected_players = 0;
-        for (int i = 0; i < 4; i++) {
-            if (players[i].connected) {
-                connected_players++;
-                if (!players[i].ready) {
-                    all_ready = false;
-                }
+    // Połączenie z puli (zamknięte wcześniej tutaj albo w shardach), nowe tylko przy pustej
+    std::unique_ptr<Connection> new_connection(int socket, sockaddr_in addr) {
+        Connection* closed;
+        for (auto& shard : shards) {
+            while (shard->take_recycled(closed)) {
+                connection_pool.release(std::unique_ptr<Connection>(closed));
             }
         }
         
-        if (all_ready && connected_players == 4) {
-            start_game();
+        std::unique_ptr<Connection> conn = connection_pool.acquire();
+        if (!conn) return std::make_unique<Connection>(socket, addr);
+        conn->reset(socket, addr);
+        return conn;
+    }
+    
+    void accept_stats_clients() {
+        while (true) {
+            int client_socket = accept4(stats_socket, nullptr, nullptr, SOCK_NONBLOCK);
+            if (client_socket < 0) return;
+            
+            stats_clients.insert(client_socket);
+            watch(client_socket);
         }
     }
     
-    void start_game() {
-        std::lock_guard<std::mutex> lock(game_mutex);
-        game_state.game_running = true;
-        game_state.active_players = 4;
+    // Odpowiada na żądanie (HTTP GET albo dowolna linia, np. z nc) i zamyka połączenie
+    void serve_stats(int fd) {
+        char request[1024];
+        int bytes = recv(fd, request, sizeof(request), 0);
+        if (bytes < 0 && (errno == EAGAIN || errno == EINTR)) return;
         
-        // Powiadom graczy o rozpoczęciu gry
-        uint8_t packet_type = PACKET_GAME_START;
-        for (int i = 0; i < 4; i++) {
-            if (players[i].connected) {
-                send(players[i].tcp_socket, &packet_type, 1, 0);
+        if (bytes > 0) {
+            // Reszta żądania (nagłówki) nie jest potrzebna, ale musi zostać
+            // odczytana - zamknięcie z nieodczytanymi danymi wysyła RST
+            char rest[1024];
+            while (recv(fd, rest, sizeof(rest), 0) > 0) {}
+            
+            std::string body = render_metrics();
+            std::string response;
+            if (bytes >= 4 && memcmp(request, "GET ", 4) == 0) {
+                response = "HTTP/1.0 200 OK\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n";
+            }
+            response += body;
+            
+            // Odpowiedź zwykle mieści się w buforze gniazda; wolny odbiorca dostaje
+            // ograniczony czas, po którym połączenie jest zamykane
+            int flags = fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+            timeval timeout{0, STATS_SEND_TIMEOUT_MS * 1000};
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            
+            size_t offset = 0;
+            while (offset < response.size()) {
+                ssize_t sent = send(fd, response.data() + offset, response.size() - offset, MSG_NOSIGNAL);
+                if (sent <= 0) break;
+                offset += sent;
             }
+            shutdown(fd, SHUT_WR);
         }
         
-        std::cout << "Gra rozpoczęta!\n";
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        stats_clients.erase(fd);
     }
     
-    void handle_player_leave(int player_id) {
-        players[player_id].connected = false;
-        players[player_id].ready = false;
-        close(players[player_id].tcp_socket);
+    // Suma metryk wszystkich shardów; histogramy są scalane, a nie uśredniane
+    std::string render_metrics() {
+        MetricsText text;
         
-        // Powiadom innych graczy
-        uint8_t packet_type = PACKET_PLAYER_LEFT;
-        PlayerLeftPacket packet;
-        packet.player_id = player_id;
+        ServerMetrics metrics;
+        int active_rooms = 0;
+        int players = 0;
+        int spectators = 0;
+        uint64_t queued = 0;
+        uint64_t queue_depth_peak = 0;
+        int parked = 0;
+        uint64_t udp_received = 0, udp_recv_syscalls = 0;
+        uint64_t udp_sent = 0, udp_send_syscalls = 0, udp_send_dropped = 0;
+        for (auto& shard : shards) {
+            metrics.add(shard->shard_metrics());
+            const ShardLoad& load = shard->current_load();
+            active_rooms += load.rooms_active.load(std::memory_order_relaxed);
+            players += load.players.load(std::memory_order_relaxed);
+            spectators += load.spectators.load(std::memory_order_relaxed);
+            parked += load.parked.load(std::memory_order_relaxed) ? 1 : 0;
+            queued += shard->queued_actions();
+            queue_depth_peak = std::max(queue_depth_peak, shard->take_queue_depth_peak());
+            udp_received += shard->udp_receiver().datagram_count();
+            udp_recv_syscalls += shard->udp_receiver().syscall_count();
+            udp_sent += shard->udp_sender().datagram_count();
+            udp_send_syscalls += shard->udp_sender().syscall_count();
+            udp_send_dropped += shard->udp_sender().dropped_count();
+        }
         
-        for (int i = 0; i < 4; i++) {
-            if (i != player_id && players[i].connected) {
-                send(players[i].tcp_socket, &packet_type, 1, 0);
-                send(players[i].tcp_socket, &packet, sizeof(packet), 0);
-            }
+        text.gauge("the4pong_workers", "Wątki robocze (shardy pokoi)", (double)shards.size());
+        text.gauge("the4pong_connection_pool_free", "Zamknięte połączenia gotowe do ponownego użycia",
+                   (double)connection_pool.available());
+        text.gauge("the4pong_workers_parked", "Wątki robocze bez trwających meczów (timer taktu zatrzymany)",
+                   (double)parked);
+        
+        text.counter("the4pong_ticks_total", "Wykonane takty gry (suma wątków roboczych)", metrics.ticks.get());
+        text.summary("the4pong_tick_duration_seconds", "Czas jednego taktu gry", metrics.tick_time);
+        text.summary("the4pong_sync_interval_seconds", "Odstęp między rozesłaniami migawek", metrics.sync_interval);
+        text.summary("the4pong_sync_fanout_seconds",
+                     "Czas taktu z migawkami: akcje, krok, kodowanie i wysłanie we wszystkich blokach pokoi",
+                     metrics.sync_fanout);
+        text.counter("the4pong_tick_blocks_total", "Bloki pokoi z trwającymi meczami przetworzone w taktach",
+                     metrics.tick_blocks.get());
+        text.counter("the4pong_tick_blocks_stolen_total", "Bloki pokoi przetworzone przez inny wątek roboczy",
+                     metrics.tick_blocks_stolen.get());
+#if COUNT_ALLOCS
+        text.counter("the4pong_tick_allocations_total", "Alokacje na stercie w taktach gry",
+                     metrics.tick_allocations.get());
+#endif
+        text.summary("the4pong_action_latency_seconds", "Czas od odebrania akcji do jej zastosowania w takcie",
+                     metrics.action_latency);
+        text.summary("the4pong_rtt_seconds", "Czas od wysłania migawki do jej potwierdzenia", metrics.rtt);
+        
+        text.gauge("the4pong_rooms_active", "Zajęte pokoje", active_rooms);
+        text.gauge("the4pong_players_connected", "Połączeni gracze", players);
+        text.gauge("the4pong_spectators_connected", "Połączeni widzowie", spectators);
+        text.gauge("the4pong_action_queue_depth", "Akcje oczekujące w kolejkach pokoi", (double)queued);
+        text.gauge("the4pong_action_queue_depth_peak",
+                   "Największa głębokość kolejki akcji od poprzedniego odczytu", (double)queue_depth_peak);
+        
+        text.counter("the4pong_actions_received_total", "Przyjęte akcje graczy", metrics.actions_received.get());
+        text.counter("the4pong_actions_dropped_total", "Akcje odrzucone przy pełnej kolejce",
+                     metrics.actions_dropped.get());
+        text.counter("the4pong_snapshots_sent_total", "Wysłane migawki stanu gry", metrics.snapshots_sent.get());
+        text.counter("the4pong_snapshot_bytes_total", "Bajty wysłanych migawek", metrics.snapshot_bytes.get());
+        text.counter("the4pong_spectator_snapshots_sent_total", "Migawki wysłane widzom",
+                     metrics.spectator_snapshots.get());
+        
+        text.counter("the4pong_udp_received_total", "Odebrane datagramy UDP", udp_received);
+        text.counter("the4pong_udp_recv_syscalls_total", "Wywołania recvmmsg", udp_recv_syscalls);
+        text.counter("the4pong_udp_sent_total", "Wysłane datagramy UDP", udp_sent);
+        text.counter("the4pong_udp_send_syscalls_total", "Wywołania sendmmsg", udp_send_syscalls);
+        text.counter("the4pong_udp_send_dropped_total", "Datagramy, których nie udało się wysłać",
+                     udp_send_dropped);
+        text.counter("the4pong_udp_malformed_total", "Odrzucone datagramy (za krótkie lub nieznanego typu)",
+                     metrics.udp_malformed.get());
+        text.counter("the4pong_udp_unknown_token_total", "Datagramy z nieznanym tokenem sesji",
+                     metrics.udp_unknown_token.get());
+        text.counter("the4pong_tcp_frames_sent_total", "Komunikaty TCP dopisane do kolejek połączeń",
+                     metrics.tcp_frames_sent.get());
+        text.counter("the4pong_tcp_send_syscalls_total", "Zapisy kolejek komunikatów TCP do gniazd",
+                     metrics.tcp_send_syscalls.get());
+        text.counter("the4pong_tcp_slow_closed_total", "Połączenia zerwane po przepełnieniu kolejki komunikatów",
+                     metrics.tcp_slow_closed.get());
+        text.counter("the4pong_log_dropped_total", "Komunikaty odrzucone przy pełnej kolejce logów",
+                     Logger::instance().dropped_count());
+        
+        text.gauge_header("the4pong_worker_connections", "Połączenia TCP obsługiwane przez wątek roboczy");
+        for (size_t i = 0; i < shards.size(); i++) {
+            char labels[32];
+            snprintf(labels, sizeof(labels), "worker=\"%zu\"", i);
+            text.gauge_sample("the4pong_worker_connections", labels,
+                              shards[i]->current_load().connections.load(std::memory_order_relaxed));
+        }
+        
+        text.gauge_header("the4pong_player_rtt_seconds", "Wygładzony RTT gracza");
+        for (const auto& shard : shards) {
+            shard->export_player_rtt(text);
         }
         
-        std::cout << "Gracz " << player_id << " opuścił grę\n";
+        return text.str();
     }
     
-    void handle_udp_messages() {
-        char buffer[1024];
-        sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
+    
+    void handle_tcp_event(int fd) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) return;
+        Connection& conn = *it->second;
         
-        while (running) {
-            int bytes = recvfrom(udp_socket, buffer, sizeof(buffer), MSG_DONTWAIT, 
-                            (sockaddr*)&client_addr, &addr_len);
-            
-            if (bytes <= 0) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                continue;
+        while (true) {
+            FrameIo result = conn.reader.fill(fd);
+            if (result == FRAME_IO_CLOSED) {
+                close_connection(conn);
+                return;
             }
-            
-            if (bytes < sizeof(uint8_t) + sizeof(PlayerActionPacket)) continue;
-            
-            uint8_t packet_type = buffer[0];
-            if (packet_type != PACKET_PLAYER_ACTION) continue;
-            
-            PlayerActionPacket* action_packet = (PlayerActionPacket*)(buffer + 1);
-            
-            // POPRAWKA: Znajdź gracza po adresie IP (port może się różnić)
-            int player_id = -1;
-            for (int i = 0; i < 4; i++) {
-                if (players[i].connected && 
-                    players[i].udp_addr.sin_addr.s_addr == client_addr.sin_addr.s_addr) {
-                    player_id = i;
-                    // Zaktualizuj port UDP gracza na aktualny
-                    players[i].udp_addr.sin_port = client_addr.sin_port;
-                    break;
-                }
+            if (!process_messages(conn)) return;
+            if (result == FRAME_IO_AGAIN) return;
+        }
+    }
+    
+    // HELLO, a po nim komunikat wyboru pokoju, który zostaje w buforze i razem
+    // z połączeniem trafia do shardu. false, jeśli połączenie zostało zamknięte
+    // albo przekazane.
+    bool process_messages(Connection& conn) {
+        Frame frame;
+        while (conn.reader.peek(frame)) {
+            if (conn.stage == STAGE_SELECT_ROOM) {
+                route_connection(conn, frame);
+                return false;
             }
             
-            if (player_id == -1) {
-                std::cout << "Nie znaleziono gracza dla adresu UDP\n";
-                continue;
+            conn.reader.next(frame);
+            HelloPacket packet;
+            if (frame.type != PACKET_HELLO || !wire_decode(frame.payload, frame.length, packet)) {
+                // Komunikat nieoczekiwany przed uzgodnieniem wersji
+                close_connection(conn);
+                return false;
             }
+            if (!handle_hello(conn, &packet)) return false;
+        }
         
-            
-            // Dodaj akcję do kolejki
-            ActionEvent event;
-            event.player_id = player_id;
-            event.action = (PlayerAction)action_packet->action;
-            event.timestamp = std::chrono::steady_clock::now();
-            
-            {
-                std::lock_guard<std::mutex> lock(queue_mutex);
-                action_queue.push(event);
-            }
-            
-            // Propaguj akcję do innych graczy
-            propagate_action(player_id, event.action);
+        // Ramka dłuższa niż dopuszcza protokół - strumień nie do odczytania
+        if (conn.reader.is_broken()) {
+            close_connection(conn);
+            return false;
         }
+        return true;
     }
     
-    void propagate_action(int player_id, PlayerAction action) {
-        char buffer[sizeof(uint8_t) + sizeof(ActionPropagationPacket)];
-        buffer[0] = PACKET_ACTION_PROPAGATION;
-        
-        ActionPropagationPacket* packet = (ActionPropagationPacket*)(buffer + 1);
-        packet->player_id = player_id;
-        packet->action = action;
+    // Uzgodnienie wersji: najnowsza wspólna albo odmowa (version = 0) i zamknięcie połączenia.
+    // Odpowiedź wychodzi od razu - pierwsza ramka na świeżym gnieździe zawsze mieści się
+    // w jego buforze, więc wątek przyjmujący nie potrzebuje kolejki wysyłki ani EPOLLOUT.
+    bool handle_hello(Connection& conn, const HelloPacket* packet) {
+        HelloAckPacket response;
+        response.version = std::min(packet->version, PROTOCOL_VERSION);
+        response.server_version = PROTOCOL_VERSION;
+        response.server_min_version = PROTOCOL_MIN_VERSION;
+        if (response.version < std::max(packet->min_version, PROTOCOL_MIN_VERSION)) {
+            response.version = 0;
+        }
+        uint8_t buffer[WIRE_MAX_SIZE<HelloAckPacket>];
+        conn.writer.queue(WireSchema<HelloAckPacket>::type, buffer, wire_encode(response, buffer));
+        bool sent = conn.writer.flush(conn.socket) == FRAME_IO_OK;
         
-        for (int i = 0; i < 4; i++) {
-            if (i != player_id && players[i].connected) {
-                sendto(udp_socket, buffer, sizeof(buffer), 0, 
-                       (sockaddr*)&players[i].udp_addr, sizeof(players[i].udp_addr));
-            }
+        if (response.version == 0) {
+            LOG_WARN("Klient " << inet_ntoa(conn.addr.sin_addr) << " z nieobsługiwaną wersją protokołu "
+                     << packet->min_version << "-" << packet->version);
+            close_connection(conn);
+            return false;
+        }
+        if (!sent) {
+            close_connection(conn);
+            return false;
         }
+        conn.stage = STAGE_SELECT_ROOM;
+        return true;
     }
     
-    void game_loop() {
-        auto last_time = std::chrono::steady_clock::now();
-        auto last_sync = last_time;
-        
-        // Uruchom obsługę UDP w osobnym wątku
-        std::thread udp_thread(&GameServer::handle_udp_messages, this);
-        
-        while (running) {
-            auto current_time = std::chrono::steady_clock::now();
-            float dt = std::chrono::duration<float>(current_time - last_time).count();
-            last_time = current_time;
-            
-            // Przetwórz akcje z kolejki
-            {
-                std::lock_guard<std::mutex> lock(queue_mutex);
-                while (!action_queue.empty()) {
-                    ActionEvent event = action_queue.front();
-                    action_queue.pop();
-                    
-                    if (game_state.game_running) {
-                        // POPRAWKA: Dodaj logowanie akcji
-                        std::cout << "Przetwarzanie akcji gracza " << event.player_id 
-                                << ": " << (int)event.action << std::endl;
-                        game_state.paddles[event.player_id].set_action(event.action);
-                    }
-                }
+    // Wybiera shard według komunikatu wyboru pokoju i przekazuje mu połączenie
+    void route_connection(Connection& conn, const Frame& frame) {
+        int shard = -1;
+        if (frame.type == PACKET_CREATE_JOIN_SERVER) {
+            CreateJoinServerPacket packet;
+            if (wire_decode(frame.payload, frame.length, packet)) {
+                shard = route_room(room_name(packet.server_name, packet.server_name_length), conn);
             }
-            
-            // POPRAWKA: Aktualizuj stan gry TYLKO gdy gra jest aktywna
-            if (game_state.game_running) {
-                std::lock_guard<std::mutex> lock(game_mutex);
-                game_state.update(dt);
-                
-                // POPRAWKA: Loguj pozycję kulki co jakiś czas
-                static int log_counter = 0;
-                if (++log_counter % 60 == 0) { // co sekundę przy 60 FPS
-                    std::cout << "Ball position: x=" << game_state.ball.x 
-                            << ", y=" << game_state.ball.y << std::endl;
-                }
+        } else if (frame.type == PACKET_JOIN_LOBBY) {
+            JoinLobbyPacket packet;
+            if (wire_decode(frame.payload, frame.length, packet)) {
+                shard = route_quick_game();
             }
-            
-            // POPRAWKA: Synchronizacja co 50ms zamiast 100ms (częściej)
-            if (std::chrono::duration<float>(current_time - last_sync).count() > 0.05f) {
-                sync_game_state();
-                last_sync = current_time;
+        } else if (frame.type == PACKET_SPECTATE) {
+            SpectatePacket packet;
+            if (wire_decode(frame.payload, frame.length, packet)) {
+                std::string name = room_name(packet.server_name, packet.server_name_length);
+                shard = name.empty() ? route_quick_spectator() : route_room(name, conn);
             }
-            
-            // 60 FPS
-            std::this_thread::sleep_for(std::chrono::milliseconds(16));
         }
         
-        if (udp_thread.joinable()) {
-            udp_thread.join();
+        // Komunikat nieoczekiwany na tym etapie albo niezgodny ze schematem
+        if (shard < 0) {
+            close_connection(conn);
+            return;
+        }
+        
+        int fd = conn.socket;
+        auto it = connections.find(fd);
+        std::unique_ptr<Connection> owned = std::move(it->second);
+        connections.erase(it);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        
+        if (shards[shard]->hand_off(owned)) {
+            handed_off[shard]++;
+            return;
         }
+        LOG_WARN("Wątek roboczy " << shard << " nie nadąża z przyjmowaniem połączeń - rozłączanie klienta "
+                 << inet_ntoa(owned->addr.sin_addr));
+        close(fd);
+        recycle(std::move(owned));
     }
     
-    void sync_game_state() {
-    if (!game_state.game_running) return;
+    template <size_t N>
+    static std::string room_name(const char (&name)[N], int length) {
+        return std::string(name, std::max(0, std::min<int>(length, N - 1)));
+    }
     
-    char buffer[sizeof(uint8_t) + sizeof(GameSyncPacket)];
-    buffer[0] = PACKET_GAME_SYNC;
+    // Nazwany pokój zostaje w shardzie, do którego trafiło pierwsze połączenie,
+    // dopóki żyje jakiekolwiek połączenie z tą nazwą; pusta nazwa to szybka gra
+    int route_room(const std::string& name, Connection& conn) {
+        if (name.empty()) return route_quick_game();
+        
+        if (routes.size() >= routes_prune_at) {
+            for (auto it = routes.begin(); it != routes.end();) {
+                if (it->second.use_count() == 1) {
+                    it = routes.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            routes_prune_at = std::max(ROUTES_PRUNE_MIN, 2 * routes.size());
+        }
+        
+        // use_count() == 1: wpis trzyma tylko katalog, więc żaden shard nie ma już
+        // tego pokoju i nikt poza tym wątkiem nie może skopiować wskaźnika
+        std::shared_ptr<RoomRoute>& route = routes[name];
+        if (!route || route.use_count() == 1) {
+            if (!route) route = std::make_shared<RoomRoute>();
+            route->shard = least_loaded_shard();
+        }
+        conn.route = route;
+        return route->shard;
+    }
     
-    GameSyncPacket* sync_packet = (GameSyncPacket*)(buffer + 1);
-    sync_packet->ball_x = game_state.ball.x;
-    sync_packet->ball_y = game_state.ball.y;
-    sync_packet->ball_velocity_x = game_state.ball.velocity_x;
-    sync_packet->ball_velocity_y = game_state.ball.velocity_y;
+    // Gracze szybkiej gry trafiają do jednego shardu, aż zapełnią pokój - rozrzuceni
+    // po shardach czekaliby w osobnych, niepełnych pokojach. Wolne miejsca opublikowane
+    // przez shard są wiarygodne tylko wtedy, gdy przyjął już wszystkie przekazane mu
+    // połączenia (inaczej część z nich może zaraz zająć te miejsca).
+    int route_quick_game() {
+        if (quick_seats == 0) {
+            quick_shard = -1;
+            for (size_t i = 0; i < shards.size() && quick_shard < 0; i++) {
+                const ShardLoad& load = shards[i]->current_load();
+                if (load.adopted.load(std::memory_order_acquire) != handed_off[i]) continue;
+                int open_seats = load.open_quick_seats.load(std::memory_order_relaxed);
+                if (open_seats > 0) {
+                    quick_shard = (int)i;
+                    quick_seats = open_seats;
+                }
+            }
+            if (quick_shard < 0) {
+                quick_shard = least_loaded_shard();
+                quick_seats = 4;
+            }
+        }
+        quick_seats--;
+        return quick_shard;
+    }
     
-    for (int i = 0; i < 4; i++) {
-        sync_packet->paddle_positions[i] = game_state.paddles[i].position;
-        sync_packet->scores[i] = game_state.scores[i];
+    // Widz szybkiej gry: shard z trwającym meczem szybkiej gry, a bez niego -
+    // z jakimkolwiek jej pokojem (shard odmówi, jeśli nie ma żadnego)
+    int route_quick_spectator() {
+        int fallback = -1;
+        for (size_t i = 0; i < shards.size(); i++) {
+            const ShardLoad& load = shards[i]->current_load();
+            if (load.watchable_quick_rooms.load(std::memory_order_relaxed) > 0) return (int)i;
+            if (fallback < 0 && load.quick_rooms.load(std::memory_order_relaxed) > 0) fallback = (int)i;
+        }
+        return fallback >= 0 ? fallback : least_loaded_shard();
     }
     
-    int sent_count = 0;
-    for (int i = 0; i < 4; i++) {
-        if (players[i].connected) {
-            int result = sendto(udp_socket, buffer, sizeof(buffer), 0,
-                               (sockaddr*)&players[i].udp_addr, sizeof(players[i].udp_addr));
-            if (result > 0) {
-                sent_count++;
-            } else {
-                std::cout << "Błąd wysyłania sync do gracza " << i << ": " << strerror(errno) << std::endl;
+    // Obciążenie to liczba połączeń shardu razem z przekazanymi, jeszcze nieprzyjętymi
+    int least_loaded_shard() const {
+        int best = 0;
+        int best_connections = shards[0]->current_load().connections.load(std::memory_order_relaxed);
+        for (size_t i = 1; i < shards.size(); i++) {
+            int connections_count = shards[i]->current_load().connections.load(std::memory_order_relaxed);
+            if (connections_count < best_connections) {
+                best = (int)i;
+                best_connections = connections_count;
             }
         }
+        return best;
     }
     
-    if (sent_count > 0) {
-        std::cout << "Wysłano sync do " << sent_count << " graczy" << std::endl;
+    void close_connection(Connection& conn) {
+        int fd = conn.socket;
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        auto it = connections.find(fd);
+        recycle(std::move(it->second));
+        connections.erase(it);
+    }
+    
+    // Trasa jest zwalniana od razu - jej licznik referencji mówi, czy pokój żyje
+    void recycle(std::unique_ptr<Connection> conn) {
+        conn->route.reset();
+        connection_pool.release(std::move(conn));
     }
-}
 };
 
 int main(int argc, char* argv[]) {
     int port = 8080;
+    int tick_rate = DEFAULT_TICK_RATE;
     if (argc > 1) {
         port = std::atoi(argv[1]);
     }
+    if (argc > 2) {
+        tick_rate = std::atoi(argv[2]);
+        if (tick_rate < MIN_TICK_RATE || tick_rate > MAX_TICK_RATE) {
+            std::cerr << "Częstotliwość taktów musi być z zakresu " << MIN_TICK_RATE
+                      << "-" << MAX_TICK_RATE << "\n";
+            return 1;
+        }
+    }
+    // Punkt statystyk (Prometheus) na 127.0.0.1, domyślnie port gry + 1; 0 wyłącza
+    int stats_port = port + 1;
+    if (argc > 3) {
+        stats_port = std::atoi(argv[3]);
+    }
+    // Katalog powtórek meczów; bez argumentu powtórki nie są zapisywane
+    std::string replay_dir;
+    if (argc > 4) {
+        replay_dir = argv[4];
+    }
+    // Wątki robocze (shardy pokoi), 0 = po jednym na procesor (najwyżej MAX_SHARDS);
+    // "przypnij" przypina każdy do osobnego procesora
+    int workers = argc > 5 ? std::atoi(argv[5]) : 0;
+    if (workers <= 0) {
+        workers = (int)std::thread::hardware_concurrency();
+    }
+    bool pin_workers = argc > 6 && strcmp(argv[6], "przypnij") == 0;
     
-    GameServer server;
-    if (!server.start(port)) {
+    // Logi serwera na standardowe wyjście, zapisywane przez osobny wątek
+    Logger::instance().start(nullptr);
+    
+    GameServer server(tick_rate, workers, pin_workers);
+    if (!replay_dir.empty()) {
+        server.record_replays(replay_dir);
+    }
+    if (!server.start(port, stats_port)) {
+        Logger::instance().stop();
         return 1;
     }
     
-    server.accept_connections();
+    server.run();
     
+    Logger::instance().stop();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,183 @@
+#pragma once
+#include "common.h"
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+// Skwantowane migawki stanu gry (GAME_SYNC) kodowane różnicowo.
+//
+// Pozycje i prędkości są zapisywane jako liczby stałoprzecinkowe int16
+// (1/256 jednostki), wyniki jako int16. Serwer koduje każdą migawkę względem
+// ostatniej migawki potwierdzonej przez danego klienta (SNAPSHOT_ACK), więc
+// wysyłane są tylko pola, które się zmieniły - zwykle sama pozycja kulki.
+// Każdy pakiet niesie też potwierdzenie wejścia adresata (SnapshotInput),
+// na podstawie którego klient uzgadnia przewidywaną pozycję swojej platformy.
+//
+// Format (po bajcie typu PACKET_GAME_SYNC, little-endian):
+//   u16 seq
+//   u16 tick            młodsze 16 bitów taktu serwera, z którego pochodzi migawka
+//   u16 mask            bity 0-7: pola z SnapshotField, bit 8: wyniki,
+//                       bit 15: migawka różnicowa (następuje u16 baseline_seq)
+//   [u16 baseline_seq]
+//   u16 input_seq       młodsze 16 bitów ostatniego zastosowanego wejścia adresata
+//   u8  input_age       ile taktów minęło od zastosowania tego wejścia
+//   i16 pole            dla każdego ustawionego bitu 0-7, po kolei
+//   i16 scores[4]       gdy ustawiony bit 8
+
+// Pola migawki (kolejność = kolejność na łączu)
+enum SnapshotField {
+    FIELD_BALL_X = 0,
+    FIELD_BALL_Y,
+    FIELD_BALL_VX,
+    FIELD_BALL_VY,
+    FIELD_PADDLE_0,
+    FIELD_PADDLE_1,
+    FIELD_PADDLE_2,
+    FIELD_PADDLE_3,
+    SNAPSHOT_FIELDS
+};
+
+const float SNAPSHOT_SCALE = 256.0f;        // jednostek stałoprzecinkowych na jednostkę areny
+const int SNAPSHOT_HISTORY = 32;            // liczba pamiętanych migawek (bazy dla różnic)
+const uint16_t SNAPSHOT_MASK_SCORES = 1 << 8;
+const uint16_t SNAPSHOT_MASK_DELTA = 1 << 15;
+const size_t SNAPSHOT_MAX_SIZE = 2 + 2 + 2 + 2 + 3 + SNAPSHOT_FIELDS * 2 + 4 * 2;
+
+struct Snapshot {
+    uint16_t seq;
+    uint16_t tick;
+    int16_t fields[SNAPSHOT_FIELDS];
+    int16_t scores[4];
+};
+
+// Potwierdzenie wejścia adresata migawki. Stan w migawce obejmuje input_age + 1
+// taktów symulowanych z wejściem input_seq (wiek jest nasycany na 255 - po takim
+// czasie platforma i tak stoi przy ścianie albo w miejscu).
+struct SnapshotInput {
+    uint16_t input_seq;  // 0 = serwer nie zastosował jeszcze żadnego wejścia
+    uint8_t input_age;
+};
+
+inline int16_t quantize(float value) {
+    float scaled = value * SNAPSHOT_SCALE;
+    if (scaled > INT16_MAX) scaled = INT16_MAX;
+    if (scaled < INT16_MIN) scaled = INT16_MIN;
+    return (int16_t)lrintf(scaled);
+}
+
+inline float dequantize(int16_t value) {
+    return value / SNAPSHOT_SCALE;
+}
+
+// Czy numer sekwencyjny a jest nowszy niż b (z uwzględnieniem przepełnienia u16)
+inline bool seq_newer(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) > 0;
+}
+
+inline void put_u16(uint8_t*& out, uint16_t value) {
+    out[0] = value & 0xFF;
+    out[1] = value >> 8;
+    out += 2;
+}
+
+inline uint16_t get_u16(const uint8_t*& in) {
+    uint16_t value = in[0] | (in[1] << 8);
+    in += 2;
+    return value;
+}
+
+// Pierścień ostatnich migawek indeksowany numerem sekwencyjnym
+class SnapshotHistory {
+public:
+    SnapshotHistory() { clear(); }
+    
+    void clear() {
+        valid.fill(false);
+    }
+    
+    void put(const Snapshot& snapshot) {
+        int index = snapshot.seq % SNAPSHOT_HISTORY;
+        items[index] = snapshot;
+        valid[index] = true;
+    }
+    
+    const Snapshot* find(uint16_t seq) const {
+        int index = seq % SNAPSHOT_HISTORY;
+        if (!valid[index] || items[index].seq != seq) return nullptr;
+        return &items[index];
+    }
+    
+private:
+    std::array<Snapshot, SNAPSHOT_HISTORY> items;
+    std::array<bool, SNAPSHOT_HISTORY> valid;
+};
+
+// Koduje migawkę względem baseline (nullptr = migawka pełna).
+// out musi mieć co najmniej SNAPSHOT_MAX_SIZE bajtów; zwraca liczbę zapisanych bajtów.
+inline size_t encode_snapshot(const Snapshot& snapshot, const Snapshot* baseline,
+                              const SnapshotInput& input, uint8_t* out) {
+    uint8_t* start = out;
+    uint16_t mask = 0;
+    
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        if (!baseline || snapshot.fields[i] != baseline->fields[i]) mask |= 1 << i;
+    }
+    if (!baseline || memcmp(snapshot.scores, baseline->scores, sizeof(snapshot.scores)) != 0) {
+        mask |= SNAPSHOT_MASK_SCORES;
+    }
+    if (baseline) mask |= SNAPSHOT_MASK_DELTA;
+    
+    put_u16(out, snapshot.seq);
+    put_u16(out, snapshot.tick);
+    put_u16(out, mask);
+    if (baseline) put_u16(out, baseline->seq);
+    put_u16(out, input.input_seq);
+    *out++ = input.input_age;
+    
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        if (mask & (1 << i)) put_u16(out, (uint16_t)snapshot.fields[i]);
+    }
+    if (mask & SNAPSHOT_MASK_SCORES) {
+        for (int i = 0; i < 4; i++) put_u16(out, (uint16_t)snapshot.scores[i]);
+    }
+    
+    return out - start;
+}
+
+// Dekoduje migawkę; bazę różnicy bierze z historii. Zwraca false dla uszkodzonego
+// pakietu albo gdy bazy nie ma już (lub jeszcze) w historii.
+inline bool decode_snapshot(const uint8_t* in, size_t length, const SnapshotHistory& history,
+                            Snapshot& snapshot, SnapshotInput& input) {
+    const uint8_t* end = in + length;
+    if (length < 6) return false;
+    
+    snapshot.seq = get_u16(in);
+    snapshot.tick = get_u16(in);
+    uint16_t mask = get_u16(in);
+    
+    if (mask & SNAPSHOT_MASK_DELTA) {
+        if (end - in < 2) return false;
+        const Snapshot* baseline = history.find(get_u16(in));
+        if (!baseline) return false;
+        memcpy(snapshot.fields, baseline->fields, sizeof(snapshot.fields));
+        memcpy(snapshot.scores, baseline->scores, sizeof(snapshot.scores));
+    } else if ((mask & 0xFF) != 0xFF || !(mask & SNAPSHOT_MASK_SCORES)) {
+        return false;  // migawka pełna musi zawierać wszystkie pola
+    }
+    
+    if (end - in < 3) return false;
+    input.input_seq = get_u16(in);
+    input.input_age = *in++;
+    
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        if (!(mask & (1 << i))) continue;
+        if (end - in < 2) return false;
+        snapshot.fields[i] = (int16_t)get_u16(in);
+    }
+    if (mask & SNAPSHOT_MASK_SCORES) {
+        if (end - in < 8) return false;
+        for (int i = 0; i < 4; i++) snapshot.scores[i] = (int16_t)get_u16(in);
+    }
+    
+    return in == end;
+}
\ No newline at end of file
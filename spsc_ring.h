@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <cstddef>
+
+// Rozmiar linii pamięci podręcznej - indeksy producenta i konsumenta leżą na
+// osobnych liniach, żeby wątki nie unieważniały sobie nawzajem cache (false sharing)
+const size_t CACHE_LINE_SIZE = 64;
+
+// Ograniczony pierścień bez blokad dla jednego producenta i jednego konsumenta.
+// push() i pop() nigdy nie czekają: pełny pierścień odrzuca nowy element
+// (push zwraca false), pusty - pop zwraca false. Capacity musi być potęgą dwójki.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Pojemność pierścienia musi być potęgą dwójki");
+                  
+public:
+    SpscRing() : head(0), cached_tail(0), tail(0), cached_head(0) {}
+    
+    // Wywoływane tylko przez producenta
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head == Capacity) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head == Capacity) return false;  // pełny
+        }
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Wywoływane tylko przez konsumenta
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail) return false;  // pusty
+        }
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Przybliżona liczba elementów (dokładna, gdy nikt równolegle nie pisze)
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+    
+    bool empty() const { return size() == 0; }
+    
+    static constexpr size_t capacity() { return Capacity; }
+    
+    // Czyści pierścień - tylko gdy ani producent, ani konsument nie działają równolegle
+    void clear() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        cached_head = 0;
+        cached_tail = 0;
+    }
+    
+private:
+    // Strona konsumenta
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+    size_t cached_tail;  // ostatnio widziany tail (mniej odczytów linii producenta)
+    // Strona producenta
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+    size_t cached_head;
+    alignas(CACHE_LINE_SIZE) std::array<T, Capacity> items;
+};
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <array>
+#include <atomic>
+
+// Wsadowe wejście/wyjście UDP: jedno wywołanie recvmmsg/sendmmsg obsługuje
+// do UDP_BATCH_SIZE datagramów zamiast jednego recvfrom/sendto na pakiet.
+// UDP GSO nie jest używane - wszystkie datagramy jednego wywołania GSO muszą
+// iść pod ten sam adres, a tu prawie każdy ma innego adresata.
+// Liczniki zmienia tylko wątek właściciela gniazda, ale są atomowe, bo czyta
+// je punkt statystyk z innego wątku.
+
+const int UDP_BATCH_SIZE = 64;
+const size_t UDP_MAX_DATAGRAM = 512;  // większe pakiety nie występują w protokole
+
+// Odbiór wielu datagramów jednym recvmmsg
+class UdpRxBatch {
+public:
+    UdpRxBatch() : socket_fd(-1), count(0), syscalls(0), datagrams(0) {
+        for (int i = 0; i < UDP_BATCH_SIZE; i++) {
+            iov[i].iov_base = buffers[i].data();
+            iov[i].iov_len = UDP_MAX_DATAGRAM;
+        }
+    }
+    
+    void set_socket(int fd) { socket_fd = fd; }
+    
+    // Odbiera gotowe datagramy (bez blokowania); zwraca ich liczbę, 0 gdy brak
+    int receive() {
+        for (int i = 0; i < UDP_BATCH_SIZE; i++) {
+            memset(&headers[i], 0, sizeof(headers[i]));
+            headers[i].msg_hdr.msg_name = &addrs[i];
+            headers[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            headers[i].msg_hdr.msg_iov = &iov[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+        
+        int received = recvmmsg(socket_fd, headers.data(), UDP_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        syscalls.fetch_add(1, std::memory_order_relaxed);
+        count = received > 0 ? received : 0;
+        datagrams.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+    
+    const uint8_t* data(int i) const { return buffers[i].data(); }
+    size_t length(int i) const { return headers[i].msg_len; }
+    const sockaddr_in& addr(int i) const { return addrs[i]; }
+    
+    uint64_t syscall_count() const { return syscalls.load(std::memory_order_relaxed); }
+    uint64_t datagram_count() const { return datagrams.load(std::memory_order_relaxed); }
+    
+private:
+    int socket_fd;
+    int count;
+    std::atomic<uint64_t> syscalls;
+    std::atomic<uint64_t> datagrams;
+    std::array<std::array<uint8_t, UDP_MAX_DATAGRAM>, UDP_BATCH_SIZE> buffers;
+    std::array<sockaddr_in, UDP_BATCH_SIZE> addrs;
+    std::array<iovec, UDP_BATCH_SIZE> iov;
+    std::array<mmsghdr, UDP_BATCH_SIZE> headers;
+};
+
+// Kolejka datagramów wysyłanych jednym sendmmsg. Pakiety z całego taktu
+// (wszystkie pokoje) są zbierane przez send() i wysyłane w flush();
+// pełna kolejka jest opróżniana automatycznie.
+class UdpTxBatch {
+public:
+    UdpTxBatch() : socket_fd(-1), count(0), syscalls(0), datagrams(0), dropped(0) {}
+    
+    void set_socket(int fd) { socket_fd = fd; }
+    
+    // Kopiuje datagram do kolejki
+    void send(const void* data, size_t length, const sockaddr_in& to) {
+        if (length > UDP_MAX_DATAGRAM) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        memcpy(reserve(), data, length);
+        commit(length, to);
+    }
+    
+    // Bufor (UDP_MAX_DATAGRAM bajtów) na kolejny datagram - pakiet można
+    // zakodować w nim bezpośrednio, bez bufora pośredniego i kopiowania.
+    // Bufory kolejki są wspólną przestrzenią tymczasową całego taktu:
+    // żyją do flush(), a po nim są używane od początku. Bez commit()
+    // bufor zostanie użyty dla następnego datagramu.
+    uint8_t* reserve() {
+        if (count == UDP_BATCH_SIZE) flush();
+        return buffers[count].data();
+    }
+        
+    // Dodaje do kolejki datagram zapisany w buforze z reserve()
+    void commit(size_t length, const sockaddr_in& to) {
+        addrs[count] = to;
+        iov[count].iov_base = buffers[count].data();
+        iov[count].iov_len = length;
+        count++;
+    }
+    
+    // Dodaje datagram bez kopiowania - dane muszą pozostać niezmienione
+    // do najbliższego flush() (np. jedna migawka wysyłana wielu odbiorcom)
+    void send_shared(const void* data, size_t length, const sockaddr_in& to) {
+        if (length > UDP_MAX_DATAGRAM) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (count == UDP_BATCH_SIZE) flush();
+        
+        addrs[count] = to;
+        iov[count].iov_base = const_cast<void*>(data);
+        iov[count].iov_len = length;
+        count++;
+    }
+    
+    void flush() {
+        int offset = 0;
+        while (offset < count) {
+            for (int i = offset; i < count; i++) {
+                memset(&headers[i], 0, sizeof(headers[i]));
+                headers[i].msg_hdr.msg_name = &addrs[i];
+                headers[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+                headers[i].msg_hdr.msg_iov = &iov[i];
+                headers[i].msg_hdr.msg_iovlen = 1;
+            }
+            
+            int sent = sendmmsg(socket_fd, headers.data() + offset, count - offset, MSG_DONTWAIT);
+            syscalls.fetch_add(1, std::memory_order_relaxed);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                // Pełny bufor gniazda albo błąd pierwszego datagramu - pomijamy go,
+                // stan gry i tak zostanie wysłany ponownie w kolejnej migawce
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                offset++;
+                continue;
+            }
+            datagrams.fetch_add(sent, std::memory_order_relaxed);
+            offset += sent;
+        }
+        count = 0;
+    }
+    
+    int pending() const { return count; }
+    uint64_t syscall_count() const { return syscalls.load(std::memory_order_relaxed); }
+    uint64_t datagram_count() const { return datagrams.load(std::memory_order_relaxed); }
+    uint64_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+    
+private:
+    int socket_fd;
+    int count;
+    std::atomic<uint64_t> syscalls;
+    std::atomic<uint64_t> datagrams;
+    std::atomic<uint64_t> dropped;
+    std::array<std::array<uint8_t, UDP_MAX_DATAGRAM>, UDP_BATCH_SIZE> buffers;
+    std::array<sockaddr_in, UDP_BATCH_SIZE> addrs;
+    std::array<iovec, UDP_BATCH_SIZE> iov;
+    std::array<mmsghdr, UDP_BATCH_SIZE> headers;
+};
\ No newline at end of file
@@ -0,0 +1,610 @@
+#pragma once
+#include "common.h"
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+
+// Przenośny format komunikatów sieciowych. Zamiast kopiować struktury z common.h
+// bajt w bajt (kolejność bajtów i wyrównanie zależne od kompilatora i architektury)
+// każdy komunikat ma schemat opisany w czasie kompilacji: listę pól w kolejności
+// na łączu i liczbę bitów każdego z nich. Pola są upakowane bit po bicie
+// (little-endian, najmłodszy bit pierwszy), więc np. akcja gracza zajmuje 2 bity,
+// a PLAYER_ACTION 14 bajtów zamiast 40.
+//
+// Część stała (wszystkie pola liczbowe i długości napisów) ma stałe położenie
+// każdego pola, znane kompilatorowi: pole to przesunięcie i maska na słowie
+// 64-bitowym o stałym indeksie, bez pętli i licznika pozycji, a słowa części
+// stałej są czytane prosto z bufora wejściowego. Za nią są bajty napisów (bez
+// dopełnienia do rozmiaru tablicy). Kodowanie i dekodowanie nic nie alokuje;
+// bufor ma rozmiar WIRE_MAX_SIZE<P>.
+//
+// Wartość spoza zakresu pola jest przycinana do zakresu (nie obcinana bitowo),
+// a dekodowanie sprawdza długość komunikatu i długości napisów. Nadmiarowe bajty
+// na końcu są pomijane. Zmiana schematu wymaga podniesienia PROTOCOL_VERSION
+// (uzgadnianej komunikatem HELLO, którego układ nie zmienia się nigdy).
+
+// Kolejność bajtów niezależna od architektury
+inline void wire_store_le64(uint8_t* out, uint64_t value) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(out, &value, sizeof(value));
+#else
+    for (int i = 0; i < 8; i++) out[i] = (uint8_t)(value >> (8 * i));
+#endif
+}
+
+inline uint64_t wire_load_le64(const uint8_t* in) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+#else
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= (uint64_t)in[i] << (8 * i);
+    return value;
+#endif
+}
+
+// Kopia n bajtów (napis) blokami po 16 bajtów i dwoma nakładającymi się
+// przepisaniami stałej szerokości na końcu - odczyty nie wychodzą poza [src, src + n)
+inline void wire_copy_short(char* dst, const uint8_t* src, size_t n) {
+    while (n > 16) {
+        memcpy(dst, src, 16);
+        dst += 16;
+        src += 16;
+        n -= 16;
+    }
+    if (n >= 8) {
+        memcpy(dst, src, 8);
+        memcpy(dst + n - 8, src + n - 8, 8);
+    } else if (n >= 4) {
+        memcpy(dst, src, 4);
+        memcpy(dst + n - 4, src + n - 4, 4);
+    } else if (n > 0) {
+        dst[0] = (char)src[0];
+        dst[n / 2] = (char)src[n / 2];
+        dst[n - 1] = (char)src[n - 1];
+    }
+}
+
+constexpr uint64_t wire_mask(unsigned bits) {
+    return bits >= 64 ? ~0ull : (1ull << bits) - 1;
+}
+
+// Liczba bitów potrzebna do zapisania wartości 0..max_value
+constexpr unsigned wire_bits_for(uint64_t max_value) {
+    unsigned bits = 1;
+    while (bits < 64 && (max_value >> bits) != 0) bits++;
+    return bits;
+}
+
+// Część stała komunikatu jako słowa 64-bitowe (little-endian). Położenie pola
+// jest parametrem szablonu, więc put/get to stałe przesunięcia w rejestrach.
+template <unsigned Bits>
+class WireWords {
+public:
+    static constexpr size_t bytes = (Bits + 7) / 8;
+    static constexpr size_t count = (bytes + 7) / 8;
+    
+    WireWords() : words{} {}
+    
+    // Czyta dokładnie bytes bajtów z in - bez bufora z zapasem
+    void load(const uint8_t* in) {
+        for (size_t i = 0; i + 1 < count; i++) {
+            words[i] = wire_load_le64(in + 8 * i);
+        }
+        words[count - 1] = load_last(in + 8 * (count - 1));
+    }
+    
+    // Zapisuje dokładnie bytes bajtów do out
+    void store(uint8_t* out) const {
+        for (size_t i = 0; i + 1 < count; i++) {
+            wire_store_le64(out + 8 * i, words[i]);
+        }
+        store_last(out + 8 * (count - 1));
+    }
+    
+    template <size_t Offset, unsigned FieldBits>
+    void put(uint64_t value) {
+        static_assert(Offset + FieldBits <= Bits, "Pole poza częścią stałą");
+        constexpr size_t index = Offset / 64;
+        constexpr unsigned shift = Offset % 64;
+        value &= wire_mask(FieldBits);
+        words[index] |= value << shift;
+        if constexpr (shift + FieldBits > 64) {
+            words[index + 1] |= value >> (64 - shift);
+        }
+    }
+    
+    template <size_t Offset, unsigned FieldBits>
+    uint64_t get() const {
+        static_assert(Offset + FieldBits <= Bits, "Pole poza częścią stałą");
+        constexpr size_t index = Offset / 64;
+        constexpr unsigned shift = Offset % 64;
+        uint64_t value = words[index] >> shift;
+        if constexpr (shift + FieldBits > 64) {
+            value |= words[index + 1] << (64 - shift);
+        }
+        return value & wire_mask(FieldBits);
+    }
+    
+private:
+    static constexpr size_t last_bytes = bytes - 8 * (count - 1);
+
+    static uint64_t load_last(const uint8_t* in) {
+        return load_bytes<last_bytes>(in);
+    }
+    
+    // N bajtów odczytanych kawałkami 4/2/1 prosto do rejestru - memcpy do
+    // wyzerowanego słowa na stosie kończyłby się odczytem 8 bajtów z kilku
+    // mniejszych zapisów (bez przekazania z bufora zapisu procesora)
+    template <size_t N>
+    static uint64_t load_bytes(const uint8_t* in) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if constexpr (N == 8) {
+            return wire_load_le64(in);
+        } else if constexpr (N >= 4) {
+            uint32_t low;
+            memcpy(&low, in, sizeof(low));
+            return low | (load_bytes<N - 4>(in + 4) << 32);
+        } else if constexpr (N >= 2) {
+            uint16_t low;
+            memcpy(&low, in, sizeof(low));
+            return low | (load_bytes<N - 2>(in + 2) << 16);
+        } else if constexpr (N == 1) {
+            return in[0];
+        } else {
+            return 0;
+        }
+#else
+        uint64_t value = 0;
+        for (size_t i = 0; i < N; i++) value |= (uint64_t)in[i] << (8 * i);
+        return value;
+#endif
+    }
+    
+    void store_last(uint8_t* out) const {
+        constexpr size_t last = count - 1;
+        if constexpr (count > 1 && last_bytes < 8) {
+            // Jeden zapis 8 bajtów kończący się na ostatnim bajcie części stałej;
+            // jego początek powtarza końcowe bajty poprzedniego słowa
+            constexpr unsigned shift = 8 * (8 - last_bytes);
+            wire_store_le64(out + last_bytes - 8, (words[last] << shift) | (words[last - 1] >> (64 - shift)));
+        } else {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            memcpy(out, &words[last], last_bytes);
+#else
+            for (size_t i = 0; i < last_bytes; i++) out[i] = (uint8_t)(words[last] >> (8 * i));
+#endif
+        }
+    }
+    
+    uint64_t words[count];
+};
+
+template <typename T>
+struct WireMemberTraits;
+
+template <typename C, typename M>
+struct WireMemberTraits<M C::*> {
+    using Type = M;                                  // typ pola (może być tablicą)
+    using Element = std::remove_all_extents_t<M>;    // typ elementu tablicy
+    static constexpr size_t count = sizeof(M) / sizeof(Element);
+};
+
+// Pole z liczbą całkowitą (lub tablica liczb), każda na Bits bitach.
+// Signed: kod uzupełnieniowy do dwóch z rozszerzeniem znaku przy odczycie.
+template <auto Member, unsigned Bits, bool Signed>
+struct WireIntField {
+    using Traits = WireMemberTraits<decltype(Member)>;
+    using Element = typename Traits::Element;
+    static_assert(std::is_integral_v<Element>, "Pole liczbowe musi mieć typ całkowity");
+    static_assert(Bits >= 1 && Bits <= 64 && Bits <= 8 * sizeof(Element), "Niepoprawna liczba bitów pola");
+    
+    static constexpr unsigned fixed_bits = Bits * Traits::count;
+    static constexpr size_t tail_bytes = 0;
+    
+    // Zakres wartości pola na łączu
+    static constexpr int64_t min_value = Signed ? -(int64_t)(wire_mask(Bits - 1)) - 1 : 0;
+    static constexpr uint64_t max_value = Signed ? wire_mask(Bits - 1) : wire_mask(Bits);
+    
+    template <size_t Offset, typename P, typename Words>
+    static void put(const P& packet, Words& words, uint8_t*&) {
+        put_elements<Offset>(elements(packet), words, std::make_index_sequence<Traits::count>());
+    }
+    
+    template <size_t Offset, typename P, typename Words>
+    static bool get(P& packet, const Words& words) {
+        get_elements<Offset>(const_cast<Element*>(elements(packet)), words,
+                             std::make_index_sequence<Traits::count>());
+        return true;
+    }
+    
+    template <typename P>
+    static const uint8_t* get_tail(P&, const uint8_t* in, const uint8_t*) { return in; }
+    
+private:
+    template <typename P>
+    static const Element* elements(const P& packet) {
+        if constexpr (std::is_array_v<typename Traits::Type>) {
+            return &(packet.*Member)[0];
+        } else {
+            return &(packet.*Member);
+        }
+    }
+    
+    // Element tablicy I leży Offset + I * Bits bitów od początku komunikatu
+    template <size_t Offset, typename Words, size_t... I>
+    static void put_elements(const Element* values, Words& words, std::index_sequence<I...>) {
+        (words.template put<Offset + I * Bits, Bits>(clamp(values[I])), ...);
+    }
+    
+    template <size_t Offset, typename Words, size_t... I>
+    static void get_elements(Element* values, const Words& words, std::index_sequence<I...>) {
+        if constexpr (unpack_by_table) {
+            const Row& row = unpack_table.rows[words.template get<Offset, fixed_bits>()];
+            memcpy(values, row.values, sizeof(row.values));
+        } else {
+            ((values[I] = extend(words.template get<Offset + I * Bits, Bits>())), ...);
+        }
+    }
+    
+    // Mała tablica (łącznie do 8 bitów, np. akcje) rozpakowywana jednym odczytem
+    // wiersza tablicy wszystkich 2^fixed_bits wartości zamiast pola po polu
+    static constexpr bool unpack_by_table = Traits::count > 1 && fixed_bits <= 8;
+    static constexpr size_t unpack_rows = size_t(1) << (unpack_by_table ? fixed_bits : 0);
+    struct Row { Element values[Traits::count]; };
+    struct UnpackTable { Row rows[unpack_rows]; };
+    
+    static constexpr UnpackTable make_unpack_table() {
+        UnpackTable table{};
+        for (size_t bits = 0; bits < unpack_rows; bits++) {
+            for (size_t i = 0; i < Traits::count; i++) {
+                table.rows[bits].values[i] = extend((bits >> (i * Bits)) & wire_mask(Bits));
+            }
+        }
+        return table;
+    }
+    static constexpr UnpackTable unpack_table = make_unpack_table();
+    
+    static constexpr Element extend(uint64_t raw) {
+        if constexpr (Signed && Bits < 64) {
+            raw = (uint64_t)((int64_t)(raw << (64 - Bits)) >> (64 - Bits));
+        }
+        return (Element)raw;
+    }
+    
+    static uint64_t clamp(Element value) {
+        if constexpr (std::is_signed_v<Element>) {
+            int64_t v = value;
+            if (v < min_value) v = min_value;
+            if (v > (int64_t)max_value) v = (int64_t)max_value;
+            return (uint64_t)v;
+        } else {
+            uint64_t v = value;
+            return v > max_value ? max_value : v;
+        }
+    }
+};
+
+// Liczba ze znakiem, jeśli pole struktury jest ze znakiem
+template <auto Member, unsigned Bits>
+using WireInt = WireIntField<Member, Bits,
+                             std::is_signed_v<typename WireMemberTraits<decltype(Member)>::Element>>;
+
+// Liczba nieujemna 0..2^Bits-1 (np. numer gracza w polu int32_t); ujemne wartości są przycinane do 0
+template <auto Member, unsigned Bits>
+using WireUnsigned = WireIntField<Member, Bits, false>;
+
+template <typename P>
+struct WireSchema;
+
+// Struktura (lub tablica struktur) z własnym schematem, zapisana w miejscu pola
+template <auto Member>
+struct WireNested {
+    using Traits = WireMemberTraits<decltype(Member)>;
+    using Element = typename Traits::Element;
+    using Fields = typename WireSchema<Element>::Fields;
+    static_assert(Fields::tail_bytes == 0, "Zagnieżdżona struktura nie może zawierać napisów");
+    
+    static constexpr unsigned fixed_bits = Fields::fixed_bits * Traits::count;
+    static constexpr size_t tail_bytes = 0;
+    
+    template <size_t Offset, typename P, typename Words>
+    static void put(const P& packet, Words& words, uint8_t*&) {
+        put_elements<Offset>(elements(packet), words, std::make_index_sequence<Traits::count>());
+    }
+    
+    template <size_t Offset, typename P, typename Words>
+    static bool get(P& packet, const Words& words) {
+        return get_elements<Offset>(const_cast<Element*>(elements(packet)), words,
+                                    std::make_index_sequence<Traits::count>());
+    }
+    
+    template <typename P>
+    static const uint8_t* get_tail(P&, const uint8_t* in, const uint8_t*) { return in; }
+    
+private:
+    template <typename P>
+    static const Element* elements(const P& packet) {
+        if constexpr (std::is_array_v<typename Traits::Type>) {
+            return &(packet.*Member)[0];
+        } else {
+            return &(packet.*Member);
+        }
+    }
+    
+    template <size_t Offset, typename Words, size_t... I>
+    static void put_elements(const Element* values, Words& words, std::index_sequence<I...>) {
+        uint8_t* no_tail = nullptr;
+        (Fields::template put<Offset + I * Fields::fixed_bits>(values[I], words, no_tail), ...);
+    }
+    
+    template <size_t Offset, typename Words, size_t... I>
+    static bool get_elements(Element* values, const Words& words, std::index_sequence<I...>) {
+        return (Fields::template get<Offset + I * Fields::fixed_bits>(values[I], words) && ...);
+    }
+};
+
+// Napis z polem długości: długość w części stałej, znaki (bez dopełnienia) za nią.
+// Po odczycie tablica znaków jest zakończona zerem.
+template <auto LengthMember, auto CharsMember, size_t MaxLength>
+struct WireText {
+    using CharsType = typename WireMemberTraits<decltype(CharsMember)>::Type;
+    static_assert(std::is_array_v<CharsType> && MaxLength < sizeof(CharsType),
+                  "Tablica znaków musi pomieścić napis i zero kończące");
+    
+    static constexpr unsigned length_bits = wire_bits_for(MaxLength);
+    static constexpr unsigned fixed_bits = length_bits;
+    static constexpr size_t tail_bytes = MaxLength;
+    
+    // Długość do części stałej, znaki pod tail. Kopiowane jest zawsze MaxLength
+    // bajtów (stały rozmiar, bez wywołania memcpy): bufor ma miejsce na najdłuższy
+    // napis, a bajty za długością nie należą do komunikatu.
+    template <size_t Offset, typename P, typename Words>
+    static void put(const P& packet, Words& words, uint8_t*& tail) {
+        size_t count = length(packet);
+        words.template put<Offset, length_bits>(count);
+        memcpy(tail, packet.*CharsMember, MaxLength);
+        tail += count;
+    }
+    
+    template <size_t Offset, typename P, typename Words>
+    static bool get(P& packet, const Words& words) {
+        uint64_t value = words.template get<Offset, length_bits>();
+        if (value > MaxLength) return false;
+        packet.*LengthMember = (std::remove_reference_t<decltype(packet.*LengthMember)>)value;
+        return true;
+    }
+    
+    template <typename P>
+    static const uint8_t* get_tail(P& packet, const uint8_t* in, const uint8_t* end) {
+        if (!in) return nullptr;
+        size_t count = (size_t)(packet.*LengthMember);
+        if ((size_t)(end - in) < count) return nullptr;
+        wire_copy_short(packet.*CharsMember, in, count);
+        (packet.*CharsMember)[count] = '\0';
+        return in + count;
+    }
+    
+private:
+    // Długość z pola struktury, ograniczona do MaxLength i do pierwszego zera w tablicy
+    template <typename P>
+    static size_t length(const P& packet) {
+        auto declared = packet.*LengthMember;
+        size_t count = declared < 0 ? 0 : std::min<size_t>((size_t)declared, MaxLength);
+        return strnlen(packet.*CharsMember, count);
+    }
+};
+
+// Lista pól w kolejności na łączu
+template <typename... Field>
+struct WireFields {
+    static constexpr unsigned fixed_bits = (0u + ... + Field::fixed_bits);
+    static constexpr size_t fixed_bytes = (fixed_bits + 7) / 8;
+    static constexpr size_t tail_bytes = (size_t(0) + ... + Field::tail_bytes);
+    static constexpr size_t max_bytes = fixed_bytes + tail_bytes;
+    
+    // Położenie (w bitach) pola Index względem początku listy
+    template <size_t Index>
+    static constexpr size_t offset_of() {
+        constexpr unsigned bits[] = {Field::fixed_bits...};
+        size_t offset = 0;
+        for (size_t i = 0; i < Index; i++) offset += bits[i];
+        return offset;
+    }
+    
+    // Offset - położenie listy w komunikacie (niezerowe dla struktur zagnieżdżonych)
+    // tail - miejsce na znaki kolejnego napisu (za częścią stałą)
+    template <size_t Offset, typename P, typename Words>
+    static void put(const P& packet, Words& words, uint8_t*& tail) {
+        put_fields<Offset>(packet, words, tail, std::index_sequence_for<Field...>());
+    }
+    
+    template <size_t Offset, typename P, typename Words>
+    static bool get(P& packet, const Words& words) {
+        return get_fields<Offset>(packet, words, std::index_sequence_for<Field...>());
+    }
+    
+    // nullptr, gdy komunikat jest za krótki
+    template <typename P>
+    static const uint8_t* get_tail(P& packet, const uint8_t* in, const uint8_t* end) {
+        ((in = Field::get_tail(packet, in, end)), ...);
+        return in;
+    }
+    
+private:
+    template <size_t Offset, typename P, typename Words, size_t... I>
+    static void put_fields(const P& packet, Words& words, uint8_t*& tail, std::index_sequence<I...>) {
+        (Field::template put<Offset + offset_of<I>()>(packet, words, tail), ...);
+    }
+    
+    template <size_t Offset, typename P, typename Words, size_t... I>
+    static bool get_fields(P& packet, const Words& words, std::index_sequence<I...>) {
+        return (Field::template get<Offset + offset_of<I>()>(packet, words) && ...);
+    }
+};
+
+template <typename P>
+constexpr size_t WIRE_MAX_SIZE = WireSchema<P>::Fields::max_bytes;
+
+// Koduje komunikat do out (co najmniej WIRE_MAX_SIZE<P> bajtów); zwraca liczbę bajtów
+template <typename P>
+inline size_t wire_encode(const P& packet, uint8_t* out) {
+    using Fields = typename WireSchema<P>::Fields;
+    WireWords<Fields::fixed_bits> words;
+    uint8_t* tail = out + Fields::fixed_bytes;
+    Fields::template put<0>(packet, words, tail);
+    words.store(out);
+    return tail - out;
+}
+
+// Dekoduje komunikat; false, gdy jest za krótki albo ma niepoprawną długość napisu
+template <typename P>
+inline bool wire_decode(const uint8_t* in, size_t length, P& packet) {
+    using Fields = typename WireSchema<P>::Fields;
+    if (length < Fields::fixed_bytes) return false;
+    
+    WireWords<Fields::fixed_bits> words;
+    words.load(in);
+    if (!Fields::template get<0>(packet, words)) return false;
+    return Fields::get_tail(packet, in + Fields::fixed_bytes, in + length) != nullptr;
+}
+
+// Datagram UDP: bajt typu i zakodowany komunikat
+template <typename P>
+inline size_t wire_encode_datagram(const P& packet, uint8_t* out) {
+    out[0] = WireSchema<P>::type;
+    return 1 + wire_encode(packet, out + 1);
+}
+
+// --- Schematy komunikatów ---
+// Zakresy pól wynikają z protokołu: numer gracza 0..3, akcja 0..2, takty/s do MAX_TICK_RATE
+
+static_assert(MAX_TICK_RATE < 256, "Częstotliwość taktów zajmuje 8 bitów - zmiana wymaga nowej wersji protokołu");
+static_assert(INPUT_REDUNDANCY < 8, "Liczba wejść w PLAYER_ACTION zajmuje 3 bity");
+
+// HELLO i HELLO_ACK mają ten sam układ we wszystkich wersjach protokołu
+template <> struct WireSchema<HelloPacket> {
+    static constexpr uint8_t type = PACKET_HELLO;
+    using Fields = WireFields<
+        WireUnsigned<&HelloPacket::version, 16>,
+        WireUnsigned<&HelloPacket::min_version, 16>>;
+};
+
+template <> struct WireSchema<HelloAckPacket> {
+    static constexpr uint8_t type = PACKET_HELLO_ACK;
+    using Fields = WireFields<
+        WireUnsigned<&HelloAckPacket::version, 16>,
+        WireUnsigned<&HelloAckPacket::server_version, 16>,
+        WireUnsigned<&HelloAckPacket::server_min_version, 16>>;
+};
+
+template <> struct WireSchema<CreateJoinServerPacket> {
+    static constexpr uint8_t type = PACKET_CREATE_JOIN_SERVER;
+    using Fields = WireFields<
+        WireText<&CreateJoinServerPacket::server_name_length, &CreateJoinServerPacket::server_name, 63>>;
+};
+
+template <> struct WireSchema<ServerResponsePacket> {
+    static constexpr uint8_t type = PACKET_SERVER_RESPONSE;
+    using Fields = WireFields<
+        WireInt<&ServerResponsePacket::port, 32>>;
+};
+
+template <> struct WireSchema<JoinLobbyPacket> {
+    static constexpr uint8_t type = PACKET_JOIN_LOBBY;
+    using Fields = WireFields<
+        WireText<&JoinLobbyPacket::nick_length, &JoinLobbyPacket::nick, 20>>;
+};
+
+template <> struct WireSchema<PlayerJoinedPacket> {
+    static constexpr uint8_t type = PACKET_PLAYER_JOINED;
+    using Fields = WireFields<
+        WireUnsigned<&PlayerJoinedPacket::player_id, 2>,
+        WireUnsigned<&PlayerJoinedPacket::tick_rate, 8>,
+        WireInt<&PlayerJoinedPacket::session_token, 64>,
+        WireText<&PlayerJoinedPacket::nick_length, &PlayerJoinedPacket::nick, 20>>;
+};
+
+template <> struct WireSchema<UdpBindPacket> {
+    static constexpr uint8_t type = PACKET_UDP_BIND;
+    using Fields = WireFields<
+        WireInt<&UdpBindPacket::session_token, 64>>;
+};
+
+template <> struct WireSchema<SpectatePacket> {
+    static constexpr uint8_t type = PACKET_SPECTATE;
+    using Fields = WireFields<
+        WireUnsigned<&SpectatePacket::sync_rate, 8>,
+        WireUnsigned<&SpectatePacket::delay_ms, 16>,
+        WireText<&SpectatePacket::server_name_length, &SpectatePacket::server_name, 63>>;
+};
+
+template <> struct WireSchema<SpectateAcceptedPacket> {
+    static constexpr uint8_t type = PACKET_SPECTATE_ACCEPTED;
+    using Fields = WireFields<
+        WireUnsigned<&SpectateAcceptedPacket::tick_rate, 8>,
+        WireUnsigned<&SpectateAcceptedPacket::sync_interval_ms, 16>,
+        WireUnsigned<&SpectateAcceptedPacket::delay_ms, 16>,
+        WireInt<&SpectateAcceptedPacket::session_token, 64>>;
+};
+
+template <> struct WireSchema<ReadyPropagationPacket> {
+    static constexpr uint8_t type = PACKET_READY_PROPAGATION;
+    using Fields = WireFields<
+        WireUnsigned<&ReadyPropagationPacket::player_id, 2>>;
+};
+
+template <> struct WireSchema<PlayerActionPacket> {
+    static constexpr uint8_t type = PACKET_PLAYER_ACTION;
+    using Fields = WireFields<
+        WireInt<&PlayerActionPacket::session_token, 64>,
+        WireInt<&PlayerActionPacket::input_seq, 32>,
+        WireUnsigned<&PlayerActionPacket::count, 3>,
+        WireUnsigned<&PlayerActionPacket::actions, 2>>;
+};
+
+template <> struct WireSchema<ActionPropagationPacket> {
+    static constexpr uint8_t type = PACKET_ACTION_PROPAGATION;
+    using Fields = WireFields<
+        WireUnsigned<&ActionPropagationPacket::action, 2>,
+        WireUnsigned<&ActionPropagationPacket::player_id, 2>,
+        WireInt<&ActionPropagationPacket::input_seq, 32>>;
+};
+
+template <> struct WireSchema<PlayerScore> {
+    using Fields = WireFields<
+        WireUnsigned<&PlayerScore::player_id, 2>,
+        WireInt<&PlayerScore::score, 16>>;
+};
+
+template <> struct WireSchema<GameEndPacket> {
+    static constexpr uint8_t type = PACKET_GAME_END;
+    using Fields = WireFields<
+        WireUnsigned<&GameEndPacket::scores_len, 3>,
+        WireNested<&GameEndPacket::scores>>;
+};
+
+template <> struct WireSchema<PlayerLeftPacket> {
+    static constexpr uint8_t type = PACKET_PLAYER_LEFT;
+    using Fields = WireFields<
+        WireUnsigned<&PlayerLeftPacket::player_id, 2>>;
+};
+
+template <> struct WireSchema<SnapshotAckPacket> {
+    static constexpr uint8_t type = PACKET_SNAPSHOT_ACK;
+    using Fields = WireFields<
+        WireInt<&SnapshotAckPacket::session_token, 64>,
+        WireUnsigned<&SnapshotAckPacket::snapshot_seq, 16>>;
+};
+
+// Rozmiary na łączu (bez bajtu typu) - zmiana oznacza zmianę protokołu
+static_assert(WIRE_MAX_SIZE<HelloPacket> == 4, "Układ HELLO nie może się zmieniać");
+static_assert(WIRE_MAX_SIZE<HelloAckPacket> == 6, "Układ HELLO_ACK nie może się zmieniać");
+static_assert(WIRE_MAX_SIZE<PlayerActionPacket> == 14, "PLAYER_ACTION: 64 + 32 + 3 + 4 * 2 bity");
+static_assert(WIRE_MAX_SIZE<ActionPropagationPacket> == 5, "ACTION_PROPAGATION: 2 + 2 + 32 bity");
+static_assert(WIRE_MAX_SIZE<SnapshotAckPacket> == 10, "SNAPSHOT_ACK: 64 + 16 bitów");
+static_assert(WIRE_MAX_SIZE<GameEndPacket> == 10, "GAME_END: 3 + 4 * 18 bitów");
\ No newline at end of file